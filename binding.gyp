@@ -5,7 +5,13 @@
       'src/ffi.cc',
       'src/ref-napi.cc',
       'src/callback_info.cc',
-      'src/threaded_callback_invokation.cc'
+      'src/threaded_callback_invokation.cc',
+      'src/latency_histogram.cc',
+      'src/async_call_limiter.cc',
+      'src/call_stats.cc',
+      'src/async_dlopen.cc',
+      'src/native_callback.cc',
+      'src/pointer_map.cc'
     ],
     'include_dirs': [
       "<!@(node -p \"require('node-addon-api').include\")",
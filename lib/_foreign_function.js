@@ -11,7 +11,7 @@ const POINTER_SIZE = ref.sizeof.pointer;
 const FFI_ARG_SIZE = bindings.FFI_ARG_SIZE;
 
 
-function ForeignFunction (cif, funcPtr, returnType, argTypes) {
+function ForeignFunction (cif, funcPtr, returnType, argTypes, options) {
   debug('creating new ForeignFunction', funcPtr);
 
   const numArgs = argTypes.length;
@@ -23,6 +23,25 @@ function ForeignFunction (cif, funcPtr, returnType, argTypes) {
   const resultSize = returnType.size >= ref.sizeof.long ? returnType.size : FFI_ARG_SIZE;
   assert(resultSize > 0);
 
+  // `{ async: { maxConcurrency: N } }` caps the number of concurrent
+  // `.async()` calls on the thread pool, further calls get queued natively
+  const asyncOpts = options && options.async;
+  let limiter;
+  if (asyncOpts && asyncOpts.maxConcurrency != null) {
+    limiter = bindings.async_limiter_new(asyncOpts.maxConcurrency);
+  }
+
+  // `{ adaptive: { threshold: ms, minSamples: N } }` measures the native
+  // execution time of every call, and routes `.promise()` calls to the thread
+  // pool once the p99 exceeds the threshold
+  const adaptiveOpts = options && options.adaptive;
+  let callStats;
+  if (adaptiveOpts) {
+    const threshold = adaptiveOpts.threshold == null ? 1 : adaptiveOpts.threshold;
+    const minSamples = adaptiveOpts.minSamples == null ? 100 : adaptiveOpts.minSamples;
+    callStats = bindings.call_stats_new(threshold, minSamples);
+  }
+
   /**
    * This is the actual JS function that gets returned.
    * It handles marshalling input arguments into C values,
@@ -58,7 +77,7 @@ function ForeignFunction (cif, funcPtr, returnType, argTypes) {
     }
 
     // invoke the `ffi_call()` function
-    bindings.ffi_call(cif, funcPtr, result, argsList);
+    bindings.ffi_call(cif, funcPtr, result, argsList, callStats);
 
     result.type = returnType;
     return ref.deref(result);
@@ -103,9 +122,9 @@ function ForeignFunction (cif, funcPtr, returnType, argTypes) {
 
     // invoke the `ffi_call()` function asynchronously
     bindings.ffi_call_async(cif, funcPtr, result, argsList, function (err) {
-      // make sure that the 4 Buffers passed in above don't get GC'd while we're
-      // doing work on the thread pool...
-      [ cif, funcPtr, argsList ].map(() => {});
+      // make sure that the 4 Buffers (and the limiter and stats) passed in
+      // above don't get GC'd while we're doing work on the thread pool...
+      [ cif, funcPtr, argsList, limiter, callStats ].map(() => {});
 
       // now invoke the user-provided callback function
       if (err) {
@@ -114,7 +133,61 @@ function ForeignFunction (cif, funcPtr, returnType, argTypes) {
         result.type = returnType;
         callback(null, ref.deref(result));
       }
+    }, limiter, callStats);
+  }
+
+  /**
+   * The promise-returning version of the proxy function. Runs on the thread
+   * pool, unless created with the `adaptive` option, in which case calls stay
+   * synchronous until the function has been observed to be slow.
+   */
+
+  proxy.promise = function () {
+    debug('invoking promise proxy function');
+    const args = Array.prototype.slice.call(arguments);
+
+    if (callStats && !bindings.call_stats_offloaded(callStats)) {
+      try {
+        return Promise.resolve(proxy.apply(null, args));
+      } catch (e) {
+        return Promise.reject(e);
+      }
+    }
+
+    return new Promise(function (resolve, reject) {
+      args.push(function (err, res) {
+        if (err) {
+          reject(typeof err === 'string' ? new Error(err) : err);
+        } else {
+          resolve(res);
+        }
+      });
+      proxy.async.apply(null, args);
     });
+  };
+
+  if (callStats) {
+    /**
+     * Returns the adaptive offload decision and the native execution times:
+     * `{ threshold, minSamples, offloaded, execTime }`, where `execTime`
+     * holds `{ count, p50, p90, p99, max }` in milliseconds.
+     */
+
+    proxy.stats = function stats () {
+      return bindings.call_stats(callStats);
+    };
+  }
+
+  if (limiter) {
+    /**
+     * Returns the live counters of the concurrency limiter:
+     * `{ maxConcurrency, inFlight, queued, completed, waitTime }`, where
+     * `waitTime` holds `{ count, p50, p90, p99, max }` in milliseconds.
+     */
+
+    proxy.async.stats = function stats () {
+      return bindings.async_limiter_stats(limiter);
+    };
   }
 
   return proxy;
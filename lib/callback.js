@@ -7,7 +7,35 @@ const ref = require('./ref/ref');
 const CIF = require('./cif');
 const assert = require('assert');
 const debug = require('debug')('ffi:Callback');
-const _Callback = require('./bindings').Callback;
+const bindings = require('./bindings');
+const _Callback = bindings.Callback;
+
+// the CallbackInfo::OnFull policies of non-blocking callbacks
+const ON_FULL = { block: 0, drop: 1, error: 2 };
+
+// the CallbackInfo::NativeKind of arguments converted natively
+const KIND_VOID = 0;
+const KIND_BOOL = 11;
+const KIND_POINTER = 12;
+
+// maps the built-in types' `get()` to their CallbackInfo::NativeKind. Only
+// types still using those, and the matching `set()`, are converted natively
+const nativeKinds = new Map();
+[
+  'int8', 'uint8', 'int16', 'uint16', 'int32', 'uint32', 'int64', 'uint64',
+  'byte', 'short', 'ushort', 'int', 'uint', 'long', 'ulong', 'longlong',
+  'ulonglong', 'size_t', 'ssize_t', 'intptr_t', 'uintptr_t'
+].forEach(function (name) {
+  const type = ref.types[name];
+  // `long` is 4 bytes on Windows, but still read as a BigInt
+  if (type.max_size_is_8 !== (type.size === 8)) return;
+  const unsigned = name === 'byte' || name === 'size_t' || name[0] === 'u';
+  const kind = 2 * Math.log2(type.size) + (unsigned ? 2 : 1);
+  nativeKinds.set(type.get, { kind: kind, set: type.set, size: type.size });
+});
+nativeKinds.set(ref.types.float.get, { kind: 9, set: ref.types.float.set, size: 4 });
+nativeKinds.set(ref.types.double.get, { kind: 10, set: ref.types.double.set, size: 8 });
+nativeKinds.set(ref.types.bool.get, { kind: KIND_BOOL, set: ref.types.bool.set, size: 1 });
 
 // Function used to report errors to the current process event loop,
 // When user callback function gets gced.
@@ -29,10 +57,11 @@ function errorReportCallback (err) {
  * accept C callback functions.
  */
 
-function Callback (retType, argTypes, abi, func) {
+function Callback (retType, argTypes, abi, func, options) {
   debug('creating new Callback');
 
-  if (typeof abi === 'function') {
+  if (typeof abi === 'function' || typeof abi === 'string') {
+    options = func;
     func = abi;
     abi = undefined;
   }
@@ -40,6 +69,13 @@ function Callback (retType, argTypes, abi, func) {
   // check args
   assert(!!retType, 'expected a return "type" object as the first argument');
   assert(Array.isArray(argTypes), 'expected Array of arg "type" objects as the second argument');
+
+  // `{ workers: N }` spreads the invokations over N `worker_threads`, which
+  // load the function from the module at path `func`. Loaded lazily, as it
+  // builds on `nativeCallbacks`, which builds on this module
+  if (options && options.workers) {
+    return require('./callback_pool')(retType, argTypes, abi, func, options);
+  }
   assert.equal(typeof func, 'function', 'expected a function as the third argument');
 
   // normalize the "types" (they could be strings, so turn into real type
@@ -47,13 +83,50 @@ function Callback (retType, argTypes, abi, func) {
   retType = ref.coerceType(retType);
   argTypes = argTypes.map(ref.coerceType);
 
-  // create the `ffi_cif *` instance
-  const cif = CIF(retType, argTypes, abi);
+  // `{ nonBlocking: true, queueSize: N, onFull: 'block'|'drop'|'error' }`
+  // makes invokations from other threads queue a copy of their arguments and
+  // return right away, instead of waiting for the JS function to run.
+  // `{ batch: true }` additionally delivers all of the invokations queued
+  // since the last turn of the event loop with a single call, as an Array of
+  // argument Arrays
+  const batch = !!(options && options.batch);
+  let queueSize;
+  let onFull;
+  let batchLayout;
+  if (options && (options.nonBlocking || batch)) {
+    assert.strictEqual(retType.size, 0, 'non-blocking callbacks must return "void"');
+    queueSize = options.queueSize == null ? 1024 : options.queueSize;
+    assert(queueSize >= 1 && queueSize <= 0xffffffff, 'expected a positive "queueSize"');
+    onFull = ON_FULL[options.onFull == null ? 'block' : options.onFull];
+    assert(onFull !== undefined, 'expected "onFull" to be one of "block", "drop" or "error"');
+  }
+  if (batch) {
+    batchLayout = packedLayout(argTypes);
+  }
+
+  // get the `ffi_cif *` instance shared by this signature
+  const cif = sharedCIF(retType, argTypes, abi);
   const argc = argTypes.length;
 
+  // scalar and pointer signatures get their arguments and return value
+  // converted natively, calling `func` without any wrapper in between
+  const kinds = batch ? null : nativeKindsOf(retType, argTypes);
+  if (kinds) {
+    const derefTypes = argTypes.map(function (type, i) {
+      return kinds[i] === KIND_POINTER ? ref.derefType(type) : null;
+    });
+    const callback = _Callback(cif, retType.size, argc, errorReportCallback, func,
+      queueSize, onFull, undefined, kinds, derefTypes);
+    return finishCallback(callback, cif);
+  }
+
   const callback = _Callback(cif, retType.size, argc, errorReportCallback, (retval, params) => {
     debug('Callback function being invoked')
     try {
+      if (batch) {
+        return invokeBatch(retval, params);
+      }
+
       const args = [];
       for (var i = 0; i < argc; i++) {
         const type = argTypes[i];
@@ -73,12 +146,146 @@ function Callback (retType, argTypes, abi, func) {
     } catch (e) {
       return e;
     }
-  });
-  
+  }, queueSize, onFull, batchLayout);
+
+  // `packed` holds `count` argument tuples laid out as in `batchLayout`. When
+  // invoked from the JS thread itself, it's a regular (retval, params) pair
+  function invokeBatch (packed, count) {
+    const tuples = [];
+    if (typeof count !== 'number') {
+      const args = [];
+      for (let i = 0; i < argc; i++) {
+        const argPtr = ref.readPointer(count, i * ref.sizeof.pointer, argTypes[i].size);
+        argPtr.type = argTypes[i];
+        args.push(ref.deref(argPtr));
+      }
+      tuples.push(args);
+    } else {
+      const stride = batchLayout[0];
+      for (let t = 0; t < count; t++) {
+        const args = [];
+        for (let i = 0; i < argc; i++) {
+          args.push(ref.get(packed, t * stride + batchLayout[i + 1], argTypes[i]));
+        }
+        tuples.push(args);
+      }
+    }
+    func(tuples);
+  }
+
+  return finishCallback(callback, cif);
+}
+
+function finishCallback (callback, cif) {
   // store reference to the CIF Buffer so that it doesn't get
   // garbage collected before the callback Buffer does
   callback._cif = cif;
+
+  /**
+   * Releases the closure right away, instead of when the Buffer gets GC'd.
+   * Its trampoline gets reused for other callbacks, so the function pointer
+   * must not be called anymore after this.
+   */
+
+  let freed = false;
+  callback.free = function free () {
+    if (!freed) {
+      freed = true;
+      bindings.callback_free(callback);
+    }
+  };
   return callback;
 }
 
+/**
+ * Returns the CallbackInfo::NativeKind of each argument type followed by the
+ * one of the return type, or `null` if any of them needs its `get()`/`set()`.
+ */
+
+function nativeKindsOf (retType, argTypes) {
+  const kinds = [];
+  for (let i = 0; i <= argTypes.length; i++) {
+    const type = i < argTypes.length ? argTypes[i] : retType;
+    if (type.indirection > 1) {
+      kinds.push(KIND_POINTER);
+      continue;
+    }
+    if (i === argTypes.length && type.get === ref.types.void.get && type.size === 0) {
+      kinds.push(KIND_VOID);
+      continue;
+    }
+    const native = nativeKinds.get(type.get);
+    if (!native || native.set !== type.set || native.size !== type.size) {
+      return null;
+    }
+    kinds.push(native.kind);
+  }
+  return kinds;
+}
+
+// the `ffi_cif *` Buffers shared by all callbacks of the same signature, so
+// that freed closures can be reused without being prepared again. A tree of
+// WeakMaps keyed by the "type" objects, then a Map keyed by ABI
+const cifCache = new WeakMap();
+
+function sharedCIF (retType, argTypes, abi) {
+  let node = cifCache.get(retType);
+  if (!node) {
+    cifCache.set(retType, node = { next: new WeakMap(), cifs: new Map() });
+  }
+  argTypes.forEach(function (type) {
+    let child = node.next.get(type);
+    if (!child) {
+      node.next.set(type, child = { next: new WeakMap(), cifs: new Map() });
+    }
+    node = child;
+  });
+
+  let cif = node.cifs.get(abi);
+  if (!cif) {
+    cif = CIF(retType, argTypes, abi);
+    node.cifs.set(abi, cif);
+  }
+  return cif;
+}
+
+/**
+ * Returns `[stride, offset0, offset1, ...]` of the given argument types laid
+ * out like the fields of a C struct, the format batched invokations are
+ * packed in.
+ */
+
+function packedLayout (argTypes) {
+  const offsets = [];
+  let size = 0;
+  let maxAlignment = 1;
+  argTypes.forEach(function (type) {
+    const alignment = type.indirection > 1 ? ref.alignof.pointer : type.alignment;
+    const typeSize = type.indirection > 1 ? ref.sizeof.pointer : type.size;
+    assert(alignment > 0, 'batched callbacks require argument types with a known alignment');
+    size = Math.ceil(size / alignment) * alignment;
+    offsets.push(size);
+    size += typeSize;
+    maxAlignment = Math.max(maxAlignment, alignment);
+  });
+  const stride = Math.max(Math.ceil(size / maxAlignment) * maxAlignment, 1);
+  return [ stride ].concat(offsets);
+}
+
+/**
+ * Sets how many iterations a native thread invoking a callback busy-waits
+ * for the JS thread to finish, before going to sleep. Trades CPU time for
+ * lower latency of short callbacks called from other threads. Defaults to 0.
+ */
+
+Callback.setSpinCount = function setSpinCount (count) {
+  bindings.callback_spin_count(count);
+};
+
+// shared with `ffi.nativeCallbacks.collect()`
+Callback._packedLayout = packedLayout;
+
+// shared with `ffi.Function`, whose callback cache is keyed by signature
+Callback._sharedCIF = sharedCIF;
+
 module.exports = Callback;
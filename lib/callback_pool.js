@@ -0,0 +1,134 @@
+'use strict';
+
+/**
+ * Module dependencies.
+ */
+
+const path = require('path');
+const assert = require('assert');
+const { Worker } = require('worker_threads');
+const nativeCallbacks = require('./native_callbacks');
+const debug = require('debug')('ffi:CallbackPool');
+
+// the `ffi.Callback` options passed on to the workers' callbacks
+const CALLBACK_OPTIONS = [ 'nonBlocking', 'queueSize', 'onFull', 'batch' ];
+
+// terminates the workers of pools whose function pointer got GC'd. Not
+// available before Node.js v14.6.0, where only `close()` terminates them
+const registry = typeof FinalizationRegistry === 'function'
+  ? new FinalizationRegistry(function (workers) {
+    workers.forEach(worker => worker.terminate());
+  })
+  : null;
+
+/**
+ * Creates `options.workers` `worker_threads`, each one with an `ffi.Callback`
+ * of its own, and returns a single function pointer that dispatches
+ * invokations to them natively: round-robin, or by the value of argument
+ * number `options.key`. A native thread calling it waits for its worker
+ * only, so callbacks from many native threads run in parallel.
+ *
+ * The workers `require()` the module at path `modulePath`, which exports
+ * the callback's JS function, and the types must be given by name. The
+ * pointer is returned right away, `pointer.ready` resolves once all of the
+ * workers have started; a call made before then waits for its worker.
+ */
+
+function CallbackPool (retType, argTypes, abi, modulePath, options) {
+  const size = options.workers;
+  assert(Number.isInteger(size) && size > 0, 'expected a positive integer number of "workers"');
+  assert(typeof modulePath === 'string',
+    'pooled callbacks require the path of a module exporting the function');
+  assert(typeof retType === 'string' && argTypes.every(type => typeof type === 'string'),
+    'pooled callbacks require types given by name, to pass them to the workers');
+  debug('creating a pool of %d callback workers', size);
+
+  const callbackOptions = {};
+  CALLBACK_OPTIONS.forEach(function (name) {
+    if (options[name] !== undefined) {
+      callbackOptions[name] = options[name];
+    }
+  });
+
+  // the router's table: the workers' callback addresses, published by the
+  // workers themselves, then the closed flag and the count of calls in flight
+  const table = new BigUint64Array(new SharedArrayBuffer(8 * (size + 2)));
+  const pointer = nativeCallbacks.route(retType, argTypes, table, {
+    key: options.key,
+    abi: abi
+  });
+
+  const workers = [];
+  const started = [];
+  for (let index = 0; index < size; index++) {
+    const worker = new Worker(path.join(__dirname, 'callback_pool_worker.js'), {
+      workerData: {
+        index, table, retType, argTypes, abi,
+        modulePath: path.resolve(modulePath),
+        options: callbackOptions
+      }
+    });
+    // like regular callbacks, the pool doesn't keep the process running
+    worker.unref();
+    workers.push(worker);
+    started.push(new Promise(function (resolve, reject) {
+      worker.once('message', function (msg) {
+        msg.error ? reject(new Error(msg.error)) : resolve();
+      });
+      worker.once('error', reject);
+    }));
+  }
+
+  let closing;
+
+  /**
+   * Closes the router, so that calls return 0 from now on, then terminates
+   * the workers once the calls in flight have returned.
+   */
+
+  pointer.close = function close () {
+    if (!closing) {
+      Atomics.store(table, size, 1n);
+      if (registry) {
+        registry.unregister(pointer);
+      }
+      closing = new Promise(function wait (resolve) {
+        if (Atomics.load(table, size + 1) === 0n) {
+          resolve();
+        } else {
+          setTimeout(wait, 1, resolve);
+        }
+      }).then(() => Promise.all(workers.map(worker => worker.terminate()))).then(() => {});
+    }
+    return closing;
+  };
+  pointer.free = function free () {
+    pointer.close();
+  };
+
+  const timeout = options.startupTimeout == null ? 30000 : options.startupTimeout;
+  let timer;
+  pointer.ready = Promise.race([
+    Promise.all(started),
+    new Promise(function (resolve, reject) {
+      timer = setTimeout(reject, timeout, new Error('timed out waiting for the callback workers to start'));
+      timer.unref();
+    })
+  ]).then(function () {
+    clearTimeout(timer);
+  }, function (err) {
+    clearTimeout(timer);
+    pointer.close();
+    throw new Error('could not create the pooled callback: ' + (err && err.message || err));
+  });
+  // a failure also closes the pool, whether or not anyone awaits `ready`
+  pointer.ready.catch(() => {});
+
+  pointer._workers = workers;
+  if (registry) {
+    registry.register(pointer, workers, pointer);
+  }
+  return pointer;
+}
+
+module.exports = CallbackPool;
@@ -0,0 +1,29 @@
+'use strict';
+
+/**
+ * The entry point of the workers of a pooled `ffi.Callback`, see
+ * callback_pool.js. Creates the worker's own callback and publishes its
+ * address in the router's table.
+ */
+
+const { parentPort, workerData } = require('worker_threads');
+
+const { index, table } = workerData;
+const size = table.length - 2;
+
+let callback;
+try {
+  const ffi = require('./ffi');
+  const func = require(workerData.modulePath);
+  callback = ffi.Callback(workerData.retType, workerData.argTypes, workerData.abi,
+    func, workerData.options);
+  Atomics.store(table, index, ffi.ref.address(callback));
+  parentPort.postMessage({});
+} catch (err) {
+  // closes the router right away, a call waiting for this worker returns 0
+  Atomics.store(table, size, 1n);
+  parentPort.postMessage({ error: String(err && err.message || err) });
+}
+
+// keeps the worker, and with it `callback`, alive until the pool gets closed
+parentPort.on('message', function () {});
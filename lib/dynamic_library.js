@@ -11,6 +11,7 @@ const funcs = bindings.StaticFunctions;
 const ref = require('./ref/ref');
 const { types } = ref;
 const read  = require('fs').readFileSync;
+const readFile = require('fs').promises.readFile;
 
 // typedefs
 
@@ -61,13 +62,12 @@ function DynamicLibrary (path, mode) {
     // an error message is returned.
 
     // see if the error message is due to an invalid ELF header
-    let match;
-
-    if (match = err.match(/^(([^ \t()])+\.so([^ \t:()])*):([ \t])*/)) {
-      const content = read(match[1], 'ascii');
+    const script = linkerScriptPath(err);
+    if (script) {
       // try to find a GROUP ( ... ) command
-      if (match = content.match(/GROUP *\( *(([^ )])+)/)){
-        return DynamicLibrary.call(this, match[1], mode);
+      const target = linkerScriptGroup(read(script, 'ascii'));
+      if (target) {
+        return DynamicLibrary.call(this, target, mode);
       }
     }
 
@@ -76,6 +76,74 @@ function DynamicLibrary (path, mode) {
 }
 module.exports = DynamicLibrary;
 
+/**
+ * Returns the path of the linker script an "invalid ELF header" dlerror()
+ * message refers to, or `null` for any other error.
+ */
+
+function linkerScriptPath (err) {
+  const match = err.match(/^(([^ \t()])+\.so([^ \t:()])*):([ \t])*/);
+  return match ? match[1] : null;
+}
+
+/**
+ * Returns the first file name of the GROUP ( ... ) directive in the contents
+ * of a linker script, or `null` if there is none.
+ */
+
+function linkerScriptGroup (content) {
+  const match = content.match(/GROUP *\( *(([^ )])+)/);
+  return match ? match[1] : null;
+}
+
+/**
+ * Asynchronous version of the constructor. `dlopen()`s the library and
+ * resolves all of the given `symbols` on the thread pool, so that loading
+ * a large library doesn't block the event loop. Returns a Promise for the
+ * `DynamicLibrary` instance; `get()` of any of the pre-resolved `symbols`
+ * doesn't call `dlsym()` again.
+ */
+
+DynamicLibrary.open = function open (path, mode, symbols) {
+  debug('DynamicLibrary.open()', path, mode);
+
+  if (null == mode) {
+    mode = DynamicLibrary.FLAGS.RTLD_LAZY;
+  }
+  symbols = symbols || [];
+
+  return new Promise(function (resolve, reject) {
+    bindings.dlopen_async(path == null ? null : path, mode, symbols, function (err, handle, addresses) {
+      if (!err) {
+        const dl = Object.create(DynamicLibrary.prototype);
+        dl._path = path;
+        dl._handle = handle;
+        dl._symbols = new Map();
+        symbols.forEach(function (symbol, i) {
+          // unresolved symbols are left to `get()`, which throws the proper error
+          if (addresses[i] !== null) {
+            dl._symbols.set(symbol, addresses[i]);
+          }
+        });
+        return resolve(dl);
+      }
+
+      // see the constructor about the linker script handling
+      const script = linkerScriptPath(err);
+      if (!script) {
+        return reject(new Error('Dynamic Linking Error: ' + err));
+      }
+      readFile(script, 'ascii').then(function (content) {
+        const target = linkerScriptGroup(content);
+        if (!target) {
+          throw new Error('Dynamic Linking Error: ' + err);
+        }
+        return DynamicLibrary.open(target, mode, symbols);
+      }).then(resolve, reject);
+    });
+  });
+}
+
 /**
  * Set the exported flags from "dlfcn.h"
  */
@@ -105,11 +173,14 @@ DynamicLibrary.prototype.get = function (symbol) {
   debug('dlsym()', symbol);
   assert.strictEqual('string', typeof symbol);
 
-  const ptr = dlsym(this._handle, symbol);
-  assert(Buffer.isBuffer(ptr));
+  let ptr = this._symbols && this._symbols.get(symbol);
+  if (!ptr) {
+    ptr = dlsym(this._handle, symbol);
+    assert(Buffer.isBuffer(ptr));
 
-  if (ref.isNull(ptr)) {
-    throw new Error('Dynamic Symbol Retrieval Error: ' + this.error());
+    if (ref.isNull(ptr)) {
+      throw new Error('Dynamic Symbol Retrieval Error: ' + this.error());
+    }
   }
 
   ptr.name = symbol;
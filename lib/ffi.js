@@ -46,12 +46,21 @@ ref.types.size_t.ffi_type = bindings.FFI_TYPES.pointer;
 ref.types.intptr_t.ffi_type = bindings.FFI_TYPES.pointer;
 ref.types.uintptr_t.ffi_type = bindings.FFI_TYPES.pointer;
 
-// make `CString` use "ffi_type_pointer"
+// make `CString` and `OwnedCString` use "ffi_type_pointer"
 ref.types.CString.ffi_type = bindings.FFI_TYPES.pointer;
+ref.types.OwnedCString.ffi_type = bindings.FFI_TYPES.pointer;
+
+// make the wide string types use "ffi_type_pointer"
+ref.types.WString.ffi_type = bindings.FFI_TYPES.pointer;
+ref.types.U16String.ffi_type = bindings.FFI_TYPES.pointer;
+ref.types.U32String.ffi_type = bindings.FFI_TYPES.pointer;
 
 // make `Object` use the "ffi_type_pointer"
 ref.types.Object.ffi_type = bindings.FFI_TYPES.pointer;
 
+// make `handle` use the "ffi_type_pointer"
+ref.types.handle.ffi_type = bindings.FFI_TYPES.pointer;
+
 // libffi is weird when it comes to long data types (defaults to 64-bit),
 // so we emulate here, since some platforms have 32-bit longs and some
 // platforms have 64-bit longs.
@@ -79,12 +88,15 @@ exports.version = bindings.version;
 exports.CIF = require('./cif');
 exports.CIF_var = require('./cif_var');
 exports.Function = require('./function');
+exports.Interface = require('./interface');
 exports.ForeignFunction = require('./foreign_function');
 exports.VariadicForeignFunction = require('./foreign_function_var');
 exports.DynamicLibrary = require('./dynamic_library');
 exports.Library = require('./library');
 exports.Callback = require('./callback');
+exports.nativeCallbacks = require('./native_callbacks');
 exports.errno = require('./errno');
+exports.stallWatchdog = require('./stall_watchdog');
 exports.ffiType = type.Type
 
 // the shared library extension for this platform
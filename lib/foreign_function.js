@@ -16,7 +16,7 @@ const ref = require('./ref/ref');
  * execution.
  */
 
-function ForeignFunction (funcPtr, returnType, argTypes, abi) {
+function ForeignFunction (funcPtr, returnType, argTypes, abi, options) {
   debug('creating new ForeignFunction', funcPtr);
 
   // check args
@@ -33,7 +33,7 @@ function ForeignFunction (funcPtr, returnType, argTypes, abi) {
   const cif = CIF(returnType, argTypes, abi);
 
   // create and return the JS proxy function
-  return _ForeignFunction(cif, funcPtr, returnType, argTypes);
+  return _ForeignFunction(cif, funcPtr, returnType, argTypes, options);
 }
 
 module.exports = ForeignFunction;
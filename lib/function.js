@@ -7,7 +7,7 @@ const ref = require('./ref/ref');
 const assert = require('assert');
 const bindings = require('./bindings');
 const Callback = require('./callback');
-const ForeignFunction = require('./foreign_function');
+const _ForeignFunction = require('./_foreign_function');
 const debug = require('debug')('ffi:FunctionType');
 
 /**
@@ -16,6 +16,16 @@ const debug = require('debug')('ffi:FunctionType');
 
 module.exports = Function;
 
+// the Callback pointers of the JS functions written through a FunctionType,
+// one per function and signature (its shared `ffi_cif *` Buffer). Pointers
+// are held weakly: each one references its function natively, and has to
+// be collected along with the Buffers it was written to, as before. Without
+// WeakRef (before Node.js v14.6.0) there is no caching
+const callbacks = typeof WeakRef === 'function' ? new WeakMap() : null;
+
+// upper bound of the ForeignFunction proxies cached per function type
+const MAX_CACHED_PROXIES = 256;
+
 /**
  * Creates and returns a "type" object for a C "function pointer".
  *
@@ -79,7 +89,53 @@ Function.prototype.toPointer = function toPointer (fn) {
  */
 
 Function.prototype.toFunction = function toFunction (buf) {
-  return ForeignFunction(buf, this.retType, this.argTypes, this.abi);
+  assert(Buffer.isBuffer(buf), 'expected Buffer as first argument');
+  const cif = Callback._sharedCIF(this.retType, this.argTypes, this.abi);
+  if (typeof WeakRef !== 'function') {
+    return _ForeignFunction(cif, buf, this.retType, this.argTypes);
+  }
+
+  // one `ffi_cif *` per signature, and one proxy per function pointer, so
+  // reading function pointers from a vtable in a loop doesn't create new ones.
+  // A proxy holds the Buffer it calls, which for a Callback keeps the
+  // callback's closure alive, so the proxies are only held weakly
+  if (!this._proxies) {
+    this._proxies = new Map();
+  }
+  const address = ref.address(buf);
+  const cached = this._proxies.get(address);
+  let proxy = cached && cached.deref();
+  if (!proxy) {
+    proxy = _ForeignFunction(cif, buf, this.retType, this.argTypes);
+    if (!cached && this._proxies.size >= MAX_CACHED_PROXIES) {
+      this._proxies.delete(this._proxies.keys().next().value);
+    }
+    this._proxies.set(address, new WeakRef(proxy));
+  }
+  return proxy;
+};
+
+/**
+ * Returns the cached Callback pointer of `fn` for this function type's
+ * signature, creating it if there's none (left).
+ */
+
+Function.prototype._callbackFor = function _callbackFor (fn) {
+  if (!callbacks) {
+    return this.toPointer(fn);
+  }
+  let bySignature = callbacks.get(fn);
+  if (!bySignature) {
+    callbacks.set(fn, bySignature = new Map());
+  }
+  const cif = Callback._sharedCIF(this.retType, this.argTypes, this.abi);
+  const cached = bySignature.get(cif);
+  let ptr = cached && cached.deref();
+  if (!ptr) {
+    ptr = this.toPointer(fn);
+    bySignature.set(cif, new WeakRef(ptr));
+  }
+  return ptr;
 };
 
 /**
@@ -100,7 +156,7 @@ Function.prototype.set = function set (buffer, value, offset) {
   debug('ffi FunctionType "set" function');
   let ptr;
   if ('function' == typeof value) {
-    ptr = this.toPointer(value);
+    ptr = this._callbackFor(value);
   } else if (Buffer.isBuffer(value)) {
     ptr = value;
   } else {
@@ -0,0 +1,96 @@
+'use strict';
+/**
+ * Module dependencies.
+ */
+
+const ref = require('./ref/ref');
+const assert = require('assert');
+const Callback = require('./callback');
+const _ForeignFunction = require('./_foreign_function');
+const debug = require('debug')('ffi:Interface');
+
+/**
+ * Describes a C interface: a struct of function pointers, in the order of
+ * `layout`'s keys, each one defined like a `Library` function as
+ * `[ retType, [ argTypes... ] ]`. Returns a function binding the interface
+ * of an instance pointer, into an object of ForeignFunctions with the
+ * instance pre-bound as their first argument, which `layout` leaves out.
+ *
+ * By default the instance starts with a pointer to the function table, as
+ * COM objects and C++ classes do. With `{ indirect: false }` the instance is
+ * the table itself, and with `{ receiver: false }` the functions don't take
+ * the instance.
+ *
+ * The `ffi_cif *` of each distinct signature is prepared once, and binding
+ * an instance reads the whole table with a single native call.
+ */
+
+function Interface (layout, options) {
+  assert(layout && typeof layout === 'object', 'expected an interface "layout" Object');
+  const indirect = !(options && options.indirect === false);
+  const receiver = !(options && options.receiver === false);
+  const abi = options && options.abi;
+
+  const names = Object.keys(layout);
+  const methods = names.map(function (name) {
+    const def = layout[name];
+    assert(Array.isArray(def) && Array.isArray(def[1]),
+      'expected [ retType, [ argTypes... ] ] for "' + name + '"');
+    const retType = ref.coerceType(def[0]);
+    let argTypes = def[1].map(ref.coerceType);
+    if (receiver) {
+      argTypes = [ ref.types.voidPtr ].concat(argTypes);
+    }
+    const methodAbi = def[2] != null ? def[2] : abi;
+    return {
+      retType: retType,
+      argTypes: argTypes,
+      cif: Callback._sharedCIF(retType, argTypes, methodAbi)
+    };
+  });
+  debug('created interface of %d functions', names.length);
+
+  function bind (instance) {
+    assert(Buffer.isBuffer(instance), 'expected an instance pointer Buffer');
+    assert(!ref.isNull(instance), 'cannot bind the interface of a NULL pointer');
+    // read by address: the table may be longer than the instance Buffer, or
+    // than another layout already bound to it
+    const table = indirect ? ref.readPointerAt(instance, 0) : instance;
+    const pointers = ref.readPointerArrayAt(table, 0, names.length, 0);
+
+    const bound = {};
+    names.forEach(function (name, i) {
+      if (pointers[i] === null) {
+        bound[name] = null;  // optional entries left out by the implementation
+        return;
+      }
+      const m = methods[i];
+      const proxy = _ForeignFunction(m.cif, pointers[i], m.retType, m.argTypes);
+      bound[name] = receiver ? bindReceiver(proxy, instance) : proxy;
+    });
+    return bound;
+  }
+
+  bind.layout = layout;
+  return bind;
+}
+
+/**
+ * Pre-binds the instance as the first argument of a ForeignFunction proxy,
+ * its `async()` and `promise()` variants included.
+ */
+
+function bindReceiver (proxy, instance) {
+  const bound = proxy.bind(null, instance);
+  bound.async = proxy.async.bind(null, instance);
+  bound.promise = proxy.promise.bind(null, instance);
+  if (proxy.stats !== undefined) {
+    bound.stats = proxy.stats;
+  }
+  if (proxy.async.stats !== undefined) {
+    bound.async.stats = proxy.async.stats;
+  }
+  return bound;
+}
+
+module.exports = Interface;
@@ -35,10 +35,7 @@ const EXT = Library.EXT = {
 function Library (libfile, funcs, lib) {
   debug('creating Library object for', libfile);
 
-  if (libfile && typeof libfile === 'string' && libfile.indexOf(EXT) === -1) {
-    debug('appending library extension to library name', EXT);
-    libfile += EXT;
-  }
+  libfile = withExtension(libfile);
 
   if (!lib) {
     lib = {};
@@ -50,6 +47,43 @@ function Library (libfile, funcs, lib) {
     dl = libfile;
   }
 
+  return defineFunctions(dl, funcs, lib);
+}
+
+/**
+ * Asynchronous version of `Library()`. The `dlopen()` and the `dlsym()` of
+ * all the `funcs` happen on the thread pool. Returns a Promise for `lib`.
+ */
+
+Library.open = function open (libfile, funcs, lib) {
+  debug('opening Library object for', libfile);
+
+  if (libfile && typeof libfile !== 'string') {
+    return Promise.resolve().then(() => Library(libfile, funcs, lib));
+  }
+  libfile = withExtension(libfile);
+
+  return DynamicLibrary.open(libfile || null, RTLD_NOW, Object.keys(funcs || {}))
+    .then(dl => defineFunctions(dl, funcs, lib || {}));
+}
+
+/**
+ * Appends the platform's library extension, unless already present.
+ */
+
+function withExtension (libfile) {
+  if (libfile && typeof libfile === 'string' && libfile.indexOf(EXT) === -1) {
+    debug('appending library extension to library name', EXT);
+    libfile += EXT;
+  }
+  return libfile;
+}
+
+/**
+ * Creates a ForeignFunction on `lib` for every entry in `funcs`.
+ */
+
+function defineFunctions (dl, funcs, lib) {
   Object.keys(funcs || {}).forEach(function (func) {
     debug('defining function', func);
 
@@ -71,7 +105,7 @@ function Library (libfile, funcs, lib) {
     if (varargs) {
       lib[func] = VariadicForeignFunction(fptr, resultType, paramTypes, abi);
     } else {
-      const ff = ForeignFunction(fptr, resultType, paramTypes, abi);
+      const ff = ForeignFunction(fptr, resultType, paramTypes, abi, fopts);
       lib[func] = async ? ff.async : ff;
     }
   });
@@ -0,0 +1,157 @@
+'use strict';
+
+/**
+ * Module dependencies.
+ */
+
+const ref = require('./ref/ref');
+const CIF = require('./cif');
+const assert = require('assert');
+const bindings = require('./bindings');
+const Callback = require('./callback');
+const debug = require('debug')('ffi:nativeCallbacks');
+
+// the NativeCallback::Kind of each native callback
+const COMPARE_INT = 0;
+const COMPARE_UINT = 1;
+const COMPARE_FLOAT = 2;
+const COMPARE_BYTES = 3;
+const COLLECT = 4;
+const COUNT = 5;
+const ROUTE = 6;
+
+// `int (*)(const void *, const void *)`, shared by all comparators
+let comparatorCIF;
+
+/**
+ * Ready-made C function pointers implemented natively, for callbacks that
+ * would only feed `qsort()`-style APIs or accumulate their arguments. They
+ * never enter JS, so they cost no more than a C function would, and may be
+ * called from any thread. Like `ffi.Callback` pointers, they can be passed
+ * wherever a function pointer argument is expected.
+ */
+
+function create (cif, kind, width, offset, descending, layout, key) {
+  const handle = bindings.native_callback_new(cif, kind, width, offset, descending, layout, key);
+  const pointer = bindings.native_callback_pointer(handle);
+  // the closure is freed along with `handle`, which the pointer keeps alive
+  pointer._cif = cif;
+  pointer._native = handle;
+  return pointer;
+}
+
+/**
+ * Returns an `int (*)(const void *a, const void *b)` comparator of the
+ * numbers of the given `type` at `options.offset` (default 0) into the
+ * compared elements, in ascending order unless `options.descending`.
+ */
+
+exports.compare = function compare (type, options) {
+  type = ref.coerceType(type);
+  assert.strictEqual(type.indirection, 1, 'expected a number "type" to compare');
+  let kind;
+  if (type.name === 'float' || type.name === 'double') {
+    kind = COMPARE_FLOAT;
+  } else {
+    assert(/^u?int(8|16|32|64)$/.test(type.name), 'expected an integer or floating point "type" to compare');
+    kind = type.name[0] === 'u' ? COMPARE_UINT : COMPARE_INT;
+  }
+  debug('creating native comparator of', type.name);
+  return comparator(kind, type.size, options);
+};
+
+/**
+ * Returns an `int (*)(const void *a, const void *b)` comparator of the
+ * `size` bytes at `options.offset` (default 0) into the compared elements,
+ * as `memcmp()` orders them.
+ */
+
+exports.memcmp = function memcmp (size, options) {
+  assert(size > 0, 'expected a positive "size"');
+  return comparator(COMPARE_BYTES, size, options);
+};
+
+function comparator (kind, width, options) {
+  const offset = options && options.offset != null ? options.offset : 0;
+  const descending = !!(options && options.descending);
+  if (!comparatorCIF) {
+    comparatorCIF = CIF('int', [ 'pointer', 'pointer' ]);
+  }
+  return create(comparatorCIF, kind, width, offset, descending);
+}
+
+/**
+ * Returns a `void (*)(argTypes...)` sink appending the arguments of every
+ * call to a growable buffer, laid out like the fields of a C struct.
+ * `sink.values()` returns them as an Array of argument Arrays, and
+ * `sink.buffer()` as a copy of the raw bytes.
+ */
+
+exports.collect = function collect (argTypes, abi) {
+  assert(Array.isArray(argTypes) && argTypes.length > 0, 'expected an Array of arg "type" objects');
+  argTypes = argTypes.map(ref.coerceType);
+  const layout = Callback._packedLayout(argTypes);
+  const sink = create(CIF('void', argTypes, abi), COLLECT, 0, 0, false, layout);
+
+  sink.buffer = function buffer () {
+    return bindings.native_callback_contents(sink._native);
+  };
+  sink.values = function values () {
+    const packed = sink.buffer();
+    const tuples = [];
+    for (let offset = 0; offset < packed.length; offset += layout[0]) {
+      tuples.push(argTypes.map(function (type, i) {
+        return ref.get(packed, offset + layout[i + 1], type);
+      }));
+    }
+    return tuples;
+  };
+  addCount(sink);
+  return sink;
+};
+
+/**
+ * Returns a function pointer of the given signature that only counts how
+ * many times it gets called, returning 0.
+ */
+
+exports.counter = function counter (retType, argTypes, abi) {
+  const cif = CIF(retType || 'void', argTypes || [], abi);
+  const pointer = create(cif, COUNT, 0, 0, false);
+  addCount(pointer);
+  return pointer;
+};
+
+/**
+ * Returns a function pointer of the given signature forwarding each call to
+ * one of the `targets` function pointers (Buffers or BigInt addresses) of
+ * the same signature: round-robin, or picked by the value of argument
+ * number `options.key`, so calls with equal keys always go to the same one.
+ *
+ * `targets` may also be a BigUint64Array on a SharedArrayBuffer, holding
+ * the target addresses followed by two more elements: a flag closing the
+ * router, after which calls return 0, and the count of calls in flight. A
+ * target address still 0 makes the calls to it wait until it's set.
+ */
+
+exports.route = function route (retType, argTypes, targets, options) {
+  assert((Array.isArray(targets) && targets.length > 0) ||
+    (targets instanceof BigUint64Array && targets.length > 2),
+    'expected an Array of target function pointers');
+  const key = options && options.key != null ? options.key : -1;
+  const cif = CIF(retType, argTypes, options && options.abi);
+  const pointer = create(cif, ROUTE, 0, 0, false, targets, key);
+  pointer._targets = targets;
+  addCount(pointer);
+  return pointer;
+};
+
+// `count()` and `reset()` of sinks, counters and routers
+function addCount (pointer) {
+  pointer.count = function count () {
+    return bindings.native_callback_count(pointer._native);
+  };
+  pointer.reset = function reset () {
+    bindings.native_callback_reset(pointer._native);
+  };
+}
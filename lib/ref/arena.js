@@ -0,0 +1,204 @@
+'use strict';
+/**
+ * A bump allocator for native memory with a request-scoped lifetime: data
+ * that gets handed to C and dropped at the end of a request. Objects are
+ * carved out of large chunks of native memory, as Buffer views sharing the
+ * chunk's ArrayBuffer, so allocating one costs an offset increment instead
+ * of an ArrayBuffer, and the GC has nothing to track per object.
+ * `arena.allocAddress()` skips the view too, and returns a bare address for
+ * the `handle` type and the `ref.read*At()` / `ref.write*At()` accessors.
+ *
+ * `arena.reset()` releases all of the objects at once, and the chunks get
+ * reused by the next allocations. Views of released objects must not be
+ * used anymore, since their memory now belongs to the new objects.
+ * `arena.destroy()` frees the chunks themselves, right away rather than
+ * whenever the GC gets to them, and detaches the views of them.
+ *
+ * ``` js
+ * var arena = new ref.Arena()
+ * lib.handle_request(arena.allocCString(path), arena.alloc('int', flags))
+ * arena.reset()
+ * // ...
+ * arena.destroy()
+ * ```
+ */
+
+const assert = require('assert');
+const debug = require('debug')('ref:Arena');
+
+// default size of the native chunks the objects get carved out of
+const DEFAULT_CHUNK_SIZE = 64 * 1024;
+// minimum alignment of the chunks, enough for the primitive types; the
+// addresses themselves get aligned, for anything aligned to more
+const CHUNK_ALIGNMENT = 16;
+
+// the offset from `offset` on, in the chunk at `address`, at which the
+// address is aligned to `alignment`
+function alignOffset (address, offset, alignment) {
+  const misalignment = typeof address === 'number'
+    ? address % alignment
+    : Number(address % BigInt(alignment));
+  return Math.ceil((misalignment + offset) / alignment) * alignment - misalignment;
+}
+
+module.exports = function (ref) {
+
+  function Arena (options) {
+    if (!(this instanceof Arena)) {
+      return new Arena(options);
+    }
+    const chunkSize = options && options.chunkSize != null ? options.chunkSize : DEFAULT_CHUNK_SIZE;
+    assert(chunkSize > 0, 'expected a positive "chunkSize"');
+    this.chunkSize = chunkSize;
+    this._chunks = [];
+    // the addresses of the chunks, as Numbers unless past 2^53
+    this._addresses = [];
+    this._index = -1;
+    this._offset = 0;
+  }
+
+  /**
+   * Reserves `size` bytes aligned to `alignment`, from the current chunk or
+   * the next one big enough, and returns their offset in the chunk, which
+   * becomes `this._index`. Only chunks larger than `chunkSize` get allocated
+   * for objects larger than it.
+   */
+
+  Arena.prototype._reserveOffset = function _reserveOffset (size, alignment) {
+    let chunk = this._chunks[this._index];
+    let offset = chunk ? alignOffset(this._addresses[this._index], this._offset, alignment) : 0;
+    while (!chunk || offset + size > chunk.length) {
+      this._index++;
+      chunk = this._chunks[this._index];
+      if (!chunk) {
+        const align = Math.max(CHUNK_ALIGNMENT, alignment);
+        chunk = ref.allocNative(Math.max(this.chunkSize, size), { align: align });
+        const address = ref.address(chunk);
+        this._chunks.push(chunk);
+        this._addresses.push(address <= BigInt(Number.MAX_SAFE_INTEGER) ? Number(address) : address);
+        debug('allocated chunk #%d of %d bytes', this._index, chunk.length);
+      }
+      // the chunks reused after reset() may be aligned to less
+      offset = alignOffset(this._addresses[this._index], 0, alignment);
+    }
+    this._offset = offset + size;
+    return offset;
+  };
+
+  /**
+   * Returns a view of `size` bytes aligned to `alignment`, see _reserveOffset().
+   */
+
+  Arena.prototype._reserve = function _reserve (size, alignment) {
+    const offset = this._reserveOffset(size, alignment);
+    return this._chunks[this._index].subarray(offset, offset + size);
+  };
+
+  /**
+   * Same as `ref.alloc()`, in the arena.
+   */
+
+  Arena.prototype.alloc = function alloc (_type, value) {
+    const type = ref.coerceType(_type);
+    const size = type.indirection === 1 ? type.size : ref.sizeof.pointer;
+    const alignment = type.indirection === 1 ? type.alignment : ref.alignof.pointer;
+    const buffer = this._reserve(size, alignment || 1).fill(0);
+    buffer.type = type;
+    if (arguments.length >= 2) {
+      ref.set(buffer, value, 0, type);
+    }
+    return buffer;
+  };
+
+  /**
+   * Same as `ref.allocCString()`, in the arena.
+   */
+
+  Arena.prototype.allocCString = function allocCString (string, encoding) {
+    if (null == string || (Buffer.isBuffer(string) && ref.isNull(string))) {
+      return ref.NULL;
+    }
+    const size = Buffer.byteLength(string, encoding) + 1;
+    const buffer = this._reserve(size, 1);
+    ref.writeCString(buffer, string, 0, encoding);
+    buffer.type = ref.types.charPtr;
+    return buffer;
+  };
+
+  /**
+   * Returns a new instance of the given `StructType` backed by the arena,
+   * with its fields set from `data` if given.
+   */
+
+  Arena.prototype.struct = function struct (StructType, data) {
+    const buffer = this._reserve(StructType.size, StructType.alignment || 1).fill(0);
+    return new StructType(buffer, data);
+  };
+
+  /**
+   * Returns the address of `size` bytes of uninitialized memory, aligned to
+   * `alignment` (defaults to the pointer alignment), without creating a
+   * Buffer for them. The address is a Number, or a BigInt past
+   * `Number.MAX_SAFE_INTEGER`, like the ones of the `handle` type.
+   */
+
+  Arena.prototype.allocAddress = function allocAddress (size, alignment) {
+    assert(Number.isInteger(size) && size >= 0, 'expected a non-negative integer "size"');
+    alignment = alignment || ref.alignof.pointer;
+    assert(Number.isInteger(alignment) && (alignment & (alignment - 1)) === 0,
+      'expected a power of two "alignment"');
+    const offset = this._reserveOffset(size, alignment);
+    const address = this._addresses[this._index];
+    return typeof address === 'number' ? address + offset : address + BigInt(offset);
+  };
+
+  /**
+   * Releases all of the objects allocated so far, keeping the chunks for
+   * the next ones. The chunks larger than `chunkSize`, which only got
+   * allocated for a large object, are freed.
+   */
+
+  Arena.prototype.reset = function reset () {
+    const chunkSize = this.chunkSize;
+    const kept = [];
+    const addresses = [];
+    this._chunks.forEach((chunk, i) => {
+      if (chunk.length > chunkSize) {
+        ref.free(chunk);
+      } else {
+        kept.push(chunk);
+        addresses.push(this._addresses[i]);
+      }
+    });
+    this._chunks = kept;
+    this._addresses = addresses;
+    this._index = kept.length > 0 ? 0 : -1;
+    this._offset = 0;
+  };
+
+  /**
+   * Frees all of the chunks right away. The views of them get detached, and
+   * the arena starts over with new chunks if it gets used again.
+   */
+
+  Arena.prototype.destroy = function destroy () {
+    this._chunks.forEach((chunk) => ref.free(chunk));
+    debug('freed %d chunks', this._chunks.length);
+    this._chunks = [];
+    this._addresses = [];
+    this._index = -1;
+    this._offset = 0;
+  };
+
+  /**
+   * The total size of the chunks, in bytes.
+   */
+
+  Object.defineProperty(Arena.prototype, 'capacity', {
+    get: function () {
+      return this._chunks.reduce((total, chunk) => total + chunk.length, 0);
+    }
+  });
+
+  return Arena;
+};
@@ -303,11 +303,14 @@ function slice (start, end) {
  * buffer's contents until an aligned NULL pointer is encountered.
  *
  * @param {Buffer} buffer the null-terminated buffer to convert into an Array
+ * @param {Number} maxLength (optional) the maximum number of elements to scan
  * @api public
  */
 
-function untilZeros (buffer) {
-  return new this(_ref.reinterpretUntilZeros(buffer, this.type.size))
+function untilZeros (buffer, maxLength) {
+  const size = this.type.size
+  return new this(_ref.reinterpretUntilZeros(buffer, size, 0,
+    maxLength === undefined ? undefined : maxLength * size))
 }
 
 return Array_;
@@ -78,8 +78,8 @@ exports.hexAddress = function (buf) {
 }
 
 /**
- * Accepts a `Buffer` instance and returns _true_ if the buffer represents the
- * NULL pointer, _false_ otherwise.
+ * Accepts a `Buffer` instance, or a `handle` address, and returns _true_ if
+ * it represents the NULL pointer, _false_ otherwise.
  *
  * ```
  * console.log(ref.isNull(new Buffer(1)));
@@ -89,16 +89,50 @@ exports.hexAddress = function (buf) {
  * true
  * ```
  *
- * @param {Buffer} buffer The buffer to check for NULL.
+ * @param {Buffer|Number|BigInt} buffer The buffer or address to check for NULL.
  * @return {Boolean} true or false.
  * @name isNull
  * @type method
  */
 
 exports.isNull = function(buf) {
-  return exports.address(buf) === 0n
+  return nativeRef._isNull(buf)
 }
 
+/**
+ * Reads the pointer at the given _offset_ of _buffer_ as its address: a plain
+ * Number, or a BigInt for an address past `Number.MAX_SAFE_INTEGER`. `0` is
+ * NULL. This is how the `handle` type reads opaque pointers, without
+ * creating a Buffer for each one.
+ *
+ * `ref.writeAddress(buffer, address, offset)` writes one back, given as a
+ * Number, a BigInt, a Buffer or `null`.
+ *
+ * @param {Buffer} buffer The buffer to read the pointer from.
+ * @param {Number} offset The offset to read from.
+ * @return {Number|BigInt} The address.
+ * @name readAddress
+ * @type method
+ */
+
+/**
+ * Accessors for the memory at a `handle` address, with no Buffer involved:
+ * `ref.readInt32At(address, offset)` and `ref.writeInt32At(address, value,
+ * offset)`, and likewise for `Int8`, `UInt8`, `Int16`, `UInt16`, `UInt32`,
+ * `Int64` and `UInt64` (as BigInts), `Float`, `Double` and `Pointer` (as
+ * addresses). `ref.readCStringAt(address, offset)` reads a utf8 C string,
+ * and `ref.readPointerArrayAt(address, offset, count, length)` is
+ * `readPointerArray()` at an address.
+ *
+ * ```
+ * var ctx = lib.context_new()         // a `handle`
+ * var flags = ref.readUInt32At(ctx, 8)
+ * ```
+ *
+ * @name readInt32At
+ * @type method
+ */
+
 /**
  * Reads a JavaScript Object that has previously been written to the given
  * _buffer_ at the given _offset_.
@@ -166,9 +200,47 @@ exports.isNull = function(buf) {
 
 exports.readCString = function readCString (buf, offset, encoding) {
   encoding = typeof encoding !== 'string' ? 'utf8' : encoding;
+  // decoded natively, without a Buffer of the string in between
+  const latin1 = isLatin1(encoding);
+  if (latin1 || isUtf8(encoding)) {
+    return nativeRef._readCString(buf, offset >>> 0, latin1);
+  }
   return exports._reinterpretUntilZeros8(buf, offset >>> 0).toString(encoding)
 }
 
+function isUtf8 (encoding) {
+  return encoding === 'utf8' || encoding === 'utf-8';
+}
+
+function isLatin1 (encoding) {
+  return encoding === 'latin1' || encoding === 'binary';
+}
+
+/**
+ * Returns the JavaScript String read from the C String at the given pointer,
+ * a Buffer or a `handle` address, and frees its memory with `free()`. For the
+ * strings that C functions return for the caller to free, which must have
+ * been allocated by the same C runtime's `malloc()`. Returns `null` for the
+ * NULL pointer. A Buffer made for the string's address, e.g. by
+ * `readPointer()`, gets detached, so that it can't read the freed memory.
+ * Buffers allocated by JS must not be passed.
+ *
+ * ```
+ * var str = ref.readCStringAndFree(lib.describe_error(code))
+ * ```
+ *
+ * @param {Buffer|Number|BigInt} pointer The pointer to the C String.
+ * @param {String} encoding (optional) __'utf8'__ (the default) or __'latin1'__.
+ * @return {String} The String that was read.
+ */
+
+exports.readCStringAndFree = function readCStringAndFree (pointer, encoding) {
+  const latin1 = typeof encoding === 'string' && isLatin1(encoding);
+  assert(latin1 || typeof encoding !== 'string' || isUtf8(encoding),
+    'readCStringAndFree() only decodes "utf8" and "latin1"');
+  return nativeRef._readCStringAndFree(pointer, latin1);
+}
+
 /**
  * Returns a new clone of the given "type" object, with its
  * `indirection` level incremented by **1**.
@@ -434,6 +506,45 @@ exports.allocCString = function allocCString (string, encoding) {
   return buffer;
 }
 
+/**
+ * Returns a new `Buffer` instance of _size_ bytes of native memory, which
+ * gets freed right away by `ref.free()`, or when the Buffer gets garbage
+ * collected otherwise. Unlike `Buffer.alloc()`, its address can be aligned,
+ * and its size is reported to V8 as external memory.
+ *
+ * ```
+ * var table = ref.allocNative(1 << 30, { align: 64, hugePages: true })
+ * // ...
+ * ref.free(table)
+ * ```
+ *
+ * @param {Number} size The size in bytes of the memory to allocate.
+ * @param {Object} options (optional) `align`: the alignment of the address, a power of two (defaults to the pointer alignment), `hugePages`: whether to advise the kernel to back the memory with transparent huge pages (Linux only, rounds the allocation up to whole 2 MiB pages), `zero`: whether to zero-fill the memory (defaults to `false`).
+ * @return {Buffer} A new `Buffer` instance of _size_ bytes.
+ */
+
+exports.allocNative = function allocNative (size, options) {
+  assert(Number.isInteger(size) && size >= 0, 'expected a non-negative integer "size"');
+  const align = options && options.align != null ? options.align : exports.alignof.pointer;
+  const hugePages = !!(options && options.hugePages);
+  const zero = !!(options && options.zero);
+  debug('allocating %d bytes of native memory aligned to %d', size, align);
+  return exports._allocNative(size, align, hugePages, zero);
+}
+
+/**
+ * `ref.free(buffer)` frees the memory of a Buffer returned by `allocNative()`
+ * right away, and detaches it, so that it reads as empty afterwards. Freeing
+ * any other Buffer throws.
+ */
+
+/**
+ * A bump allocator for `alloc()`, `allocCString()` and struct instances that
+ * share a lifetime, freed all at once with `reset()`. See arena.js.
+ */
+
+exports.Arena = require('./arena')(exports);
+
 /**
  * Writes the given string as a C String (NULL terminated) to the given buffer
  * at the given offset. "encoding" is optional and defaults to __'utf8'__.
@@ -650,17 +761,18 @@ exports.reinterpret = function reinterpret (buffer, size, offset) {
  * @param {Buffer} buffer A Buffer instance to base the returned Buffer off of.
  * @param {Number} size The number of sequential, aligned `NULL` bytes are required to terminate the buffer.
  * @param {Number} offset The offset of the Buffer to begin from.
+ * @param {Number} maxLength (optional) The maximum length in bytes to scan, the returned Buffer is at most that long when no terminator is found before.
  * @return {Buffer} A new Buffer instance with the same memory address as _buffer_, and a variable `length` that is terminated by _size_ NUL bytes.
  */
 
-exports.reinterpretUntilZeros = function reinterpretUntilZeros (buffer, size, offset) {
+exports.reinterpretUntilZeros = function reinterpretUntilZeros (buffer, size, offset, maxLength) {
   debug('reinterpreting buffer to until "%d" NULL (0) bytes are found', size);
   const bitCount = size * 8;
   const _reinterpretUntilZeros = exports[`_reinterpretUntilZeros${bitCount}`]
   if (_reinterpretUntilZeros === undefined) {
     throw new Error(`reinterpretUntilZeros only support size 1,2,4,8 bytes, not size:${size}`)
   }
-  var rtn = _reinterpretUntilZeros(buffer, offset >>> 0);
+  var rtn = _reinterpretUntilZeros(buffer, offset >>> 0, maxLength);
   exports._attach(rtn, buffer);
   return rtn;
 };
@@ -1012,11 +1124,7 @@ types.CString = {
   alignment: nativeRef.alignof.pointer,
   indirection: 1,
   get: function get (buf, offset) {
-    const _buf = exports.readPointer(buf, offset)
-    if (exports.isNull(_buf)) {
-      return null;
-    }
-    return exports.readCString(_buf, 0);
+    return nativeRef._readCStringPointer(buf, offset, false);
   },
   set: function set (buf, val, offset) {
     let _buf
@@ -1030,6 +1138,153 @@ types.CString = {
   }
 }
 
+/**
+ * The `OwnedCString` type, for the `char *` strings whose ownership passes
+ * with them. Reading one, e.g. as the return value of a C function, frees its
+ * memory with `free()` once it's decoded, and sets the pointer to NULL, so
+ * that a struct field reads as `null` the next time. Writing one, e.g. as the
+ * return value of a callback, passes a `malloc()`'d copy that C has to free.
+ */
+
+types.OwnedCString = {
+  name: 'OwnedCString',
+  size: nativeRef.sizeof.pointer,
+  alignment: nativeRef.alignof.pointer,
+  indirection: 1,
+  get: function get (buf, offset) {
+    return nativeRef._readCStringPointer(buf, offset, true);
+  },
+  set: function set (buf, val, offset) {
+    return nativeRef._writeCStringCopy(buf, val, offset);
+  }
+}
+
+/**
+ * Returns a new `CString` type that interns the strings crossing over, for
+ * the same small set of strings getting marshalled again and again (error
+ * and type names returned by a library, SQL or keys passed to it...). Both
+ * directions have a bounded cache:
+ *
+ *  - get() returns the JS String already decoded from the same address, as
+ *    long as the bytes there are still the same ones.
+ *  - set() passes the native copy already encoded for the same JS String,
+ *    which the cache keeps alive. Once evicted, a copy lives on as long as a
+ *    Buffer it was written to does.
+ *
+ * Since every call passing the same String shares one copy, set() is only
+ * for `const char *` parameters, which C neither writes to nor keeps. Its
+ * `mutable` variant interns get() only, and passes a fresh copy per call
+ * for the `char *` ones. A single argument opts out by being passed as a
+ * Buffer, e.g. `ref.allocCString(str)`, which set() passes as is.
+ *
+ * ```
+ * var Name = ref.internedCString({ readCacheSize: 64, writeCacheSize: 64 });
+ * var lib = ffi.Library('libsqlite3', {
+ *   sqlite3_errstr: [ Name, [ 'int' ] ]
+ * });
+ * ```
+ *
+ * @param {Object} options `readCacheSize` (rounded up to a power of two) and `writeCacheSize`, 256 strings by default.
+ * @return {Object} The new `CString` type.
+ */
+
+exports.internedCString = function internedCString (options) {
+  const readCacheSize = options && options.readCacheSize != null ? options.readCacheSize : 256;
+  const writeCacheSize = options && options.writeCacheSize != null ? options.writeCacheSize : 256;
+  assert(readCacheSize >= 1, 'expected a positive "readCacheSize"');
+  assert(writeCacheSize >= 0, 'expected a non-negative "writeCacheSize"');
+
+  const readCache = nativeRef._createCStringCache(Math.pow(2, Math.ceil(Math.log2(readCacheSize))));
+  // by insertion order, the oldest copy is the first one evicted
+  const writeCache = new Map();
+
+  const type = Object.create(types.CString);
+  type.name = 'InternedCString';
+  type.get = function get (buf, offset) {
+    return nativeRef._readCStringInterned(buf, offset, readCache);
+  };
+  type.set = function set (buf, val, offset) {
+    if (Buffer.isBuffer(val) || val == null) {
+      return types.CString.set(buf, val, offset);
+    }
+    let _buf = writeCache.get(val);
+    if (_buf === undefined) {
+      _buf = exports.allocCString(val);
+      if (writeCacheSize > 0) {
+        if (writeCache.size >= writeCacheSize) {
+          writeCache.delete(writeCache.keys().next().value);
+        }
+        writeCache.set(val, _buf);
+      }
+    }
+    return exports.writePointer(buf, _buf, offset);
+  };
+
+  const mutable = Object.create(type);
+  mutable.name = 'MutableInternedCString';
+  mutable.set = types.CString.set;
+  type.mutable = mutable;
+  return type;
+};
+
+/**
+ * An interned `CString` type, with the default cache sizes of
+ * `ref.internedCString()`, shared by everything using it by name.
+ */
+
+types.InternedCString = exports.internedCString();
+
+/**
+ * Returns a wide string type of `unitSize` bytes per code unit, 2 for UTF-16
+ * or 4 for UTF-32. Strings get decoded natively, straight into JS Strings,
+ * and written as new Buffers attached to the Buffer they're written to, so
+ * the encoded argument of a function call lives as long as the call.
+ *
+ * @api private
+ */
+
+function createWideStringType (name, unitSize) {
+  return {
+    name: name,
+    size: nativeRef.sizeof.pointer,
+    alignment: nativeRef.alignof.pointer,
+    indirection: 1,
+    get: function get (buf, offset) {
+      return nativeRef._readWStringPointer(buf, offset, unitSize);
+    },
+    set: function set (buf, val, offset) {
+      let _buf
+      if (val == null) {
+        _buf = exports.NULL;
+      } else if (Buffer.isBuffer(val)) {
+        _buf = val;
+      } else {
+        _buf = nativeRef._encodeWString(val, unitSize);
+      }
+      return exports.writePointer(buf, _buf, offset);
+    }
+  }
+}
+
+/**
+ * The `U16String` type, for `char16_t *` UTF-16 strings.
+ */
+
+types.U16String = createWideStringType('U16String', 2);
+
+/**
+ * The `U32String` type, for `char32_t *` UTF-32 strings.
+ */
+
+types.U32String = createWideStringType('U32String', 4);
+
+/**
+ * The `WString` type, for `wchar_t *` strings: UTF-16 on Windows, UTF-32
+ * on the other platforms.
+ */
+
+types.WString = createWideStringType('WString', nativeRef.sizeof.wchar_t);
+
 /**
  * The `bool` type.
  *
@@ -1160,6 +1415,28 @@ types.intptr_t = createCType('intptr_t')
  */
 types.uintptr_t = createCType('uintptr_t')
 
+/**
+ * The `handle` type, for opaque pointers (`sqlite3 *`, `FILE *`, contexts...)
+ * that JS only passes around. They are read as their address, see
+ * `readAddress()`, instead of as a Buffer, and accepted back as a Number, a
+ * BigInt, a Buffer, or `null`.
+ *
+ * @name handle
+ */
+
+types.handle = {
+  name: 'handle',
+  size: nativeRef.sizeof.pointer,
+  alignment: nativeRef.alignof.pointer,
+  indirection: 1,
+  get: function get (buf, offset) {
+    return nativeRef.readAddress(buf, offset);
+  },
+  set: function set (buf, val, offset) {
+    return nativeRef.writeAddress(buf, val, offset);
+  }
+}
+
 /**
  * The `char *` type is used by "allocCString()"
  * @name charPtr
@@ -0,0 +1,67 @@
+'use strict';
+
+/**
+ * Module dependencies.
+ */
+
+const EventEmitter = require('events');
+const bindings = require('./bindings');
+const debug = require('debug')('ffi:StallWatchdog');
+
+/**
+ * Opt-in detector for synchronous foreign function calls that block the
+ * event loop. Once enabled, every call taking longer than `threshold`
+ * milliseconds increments `count` and emits a "stall" event with the
+ * function `name`, the `duration` in milliseconds and the JS `stack` of the
+ * caller. While disabled, calls are not timed at all.
+ */
+
+class StallWatchdog extends EventEmitter {
+  constructor () {
+    super();
+    this.threshold = 0;
+    this.count = 0;
+  }
+
+  enable (opts) {
+    const threshold = opts && opts.threshold != null ? opts.threshold : 50;
+    if (!(threshold > 0)) {
+      throw new RangeError('expected a positive "threshold" in milliseconds');
+    }
+    bindings.stall_watchdog_threshold(threshold);
+    this.threshold = threshold;
+    return this;
+  }
+
+  disable () {
+    bindings.stall_watchdog_threshold(0);
+    this.threshold = 0;
+    return this;
+  }
+
+  get enabled () {
+    return this.threshold > 0;
+  }
+}
+
+const watchdog = new StallWatchdog();
+
+// invoked synchronously from `ffi_call()`, so that the stack still contains
+// the caller of the stalled function
+bindings.stall_watchdog_init(function onStall (name, duration) {
+  watchdog.count++;
+  const info = { name: name === undefined ? null : name, duration, stack: null };
+  const holder = {};
+  Error.captureStackTrace(holder, onStall);
+  info.stack = holder.stack.replace(/^Error\n/, '');
+  debug('stall detected', info.name, duration);
+
+  try {
+    watchdog.emit('stall', info);
+  } catch (err) {
+    // the foreign call itself succeeded, don't make it throw
+    process.nextTick(() => { throw err; });
+  }
+});
+
+module.exports = watchdog;
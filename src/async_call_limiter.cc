@@ -0,0 +1,88 @@
+#include "ffi.h"
+
+namespace FFI {
+
+AsyncCallLimiter::AsyncCallLimiter(uint32_t max_concurrency)
+  : maxConcurrency(max_concurrency), inFlight(0), completed(0) {
+}
+
+/*
+ * Starts the given async call right away when under the concurrency limit,
+ * otherwise parks it at the back of the pending queue.
+ */
+
+void AsyncCallLimiter::Submit(AsyncCallParams* p) {
+  p->limiter = this;
+  if (inFlight < maxConcurrency) {
+    inFlight++;
+    waitTime.Record(0);
+    FFI::QueueAsyncFFICall(p);
+  } else {
+    p->queued_at = uv_hrtime();
+    pending.push(p);
+  }
+}
+
+/*
+ * Called on the main loop thread once an async call has finished. Hands the
+ * freed slot to the oldest pending call, if any.
+ */
+
+void AsyncCallLimiter::Release() {
+  completed++;
+  if (pending.empty()) {
+    inFlight--;
+    return;
+  }
+
+  AsyncCallParams* p = pending.front();
+  pending.pop();
+  waitTime.Record(uv_hrtime() - p->queued_at);
+  FFI::QueueAsyncFFICall(p);
+}
+
+/*
+ * args[0] - Number - the maximum number of concurrently running calls
+ *
+ * returns an External wrapping a new `AsyncCallLimiter`
+ */
+
+Value AsyncCallLimiter::New(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+
+  int64_t max_concurrency = args[0].ToNumber().Int64Value();
+  if (max_concurrency < 1 || max_concurrency > UINT32_MAX) {
+    throw RangeError::New(env, "maxConcurrency must be a positive integer");
+  }
+
+  AsyncCallLimiter* limiter =
+      new AsyncCallLimiter(static_cast<uint32_t>(max_concurrency));
+  return External<AsyncCallLimiter>::New(env, limiter,
+      [](Env env, AsyncCallLimiter* limiter) {
+    delete limiter;
+  });
+}
+
+/*
+ * args[0] - External - the `AsyncCallLimiter`
+ *
+ * returns `{ maxConcurrency, inFlight, queued, completed, waitTime }`
+ */
+
+Value AsyncCallLimiter::Stats(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsExternal()) {
+    throw TypeError::New(env, "async_limiter_stats() requires a limiter argument");
+  }
+
+  AsyncCallLimiter* limiter = args[0].As<External<AsyncCallLimiter>>().Data();
+  Object o = Object::New(env);
+  o["maxConcurrency"] = Number::New(env, limiter->maxConcurrency);
+  o["inFlight"] = Number::New(env, limiter->inFlight);
+  o["queued"] = Number::New(env, static_cast<double>(limiter->pending.size()));
+  o["completed"] = Number::New(env, static_cast<double>(limiter->completed));
+  o["waitTime"] = limiter->waitTime.ToObject(env);
+  return o;
+}
+
+}
@@ -0,0 +1,96 @@
+#include "ffi.h"
+
+namespace FFI {
+
+/*
+ * args[0] - String - the library path, or `null` for the main program
+ * args[1] - Number - the `dlopen()` mode flags
+ * args[2] - Array - the symbol names to resolve with `dlsym()`
+ * args[3] - Function - invoked as `fn(err, handle, addresses)` when done
+ *
+ * Symbols that can't be resolved get a `null` entry in `addresses`.
+ */
+
+void AsyncDlopen::Open(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsString() && !args[0].IsNull()) {
+    throw TypeError::New(env, "dlopen_async() requires a path string or null");
+  }
+  if (!args[2].IsArray()) {
+    throw TypeError::New(env, "dlopen_async() requires an Array of symbol names");
+  }
+  if (!args[3].IsFunction()) {
+    throw TypeError::New(env, "dlopen_async() requires a function argument");
+  }
+
+  AsyncDlopen* p = new AsyncDlopen(env);
+  p->hasPath = args[0].IsString();
+  if (p->hasPath) {
+    p->path = args[0].As<String>().Utf8Value();
+  }
+  p->mode = args[1].ToNumber().Int32Value();
+
+  Array symbols = args[2].As<Array>();
+  uint32_t count = symbols.Length();
+  p->symbols.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    p->symbols.push_back(symbols.Get(i).ToString().Utf8Value());
+  }
+
+  p->callback = Reference<Function>::New(args[3].As<Function>(), 1);
+  p->req.data = p;
+
+  uv_loop_t* loop = nullptr;
+  napi_get_uv_event_loop(env, &loop);
+  uv_queue_work(loop, &p->req, AsyncDlopen::Work, AsyncDlopen::Finish);
+}
+
+/*
+ * Called on the thread pool.
+ */
+
+void AsyncDlopen::Work(uv_work_t* req) {
+  AsyncDlopen* p = reinterpret_cast<AsyncDlopen*>(req->data);
+
+  p->handle = dlopen(p->hasPath ? p->path.c_str() : nullptr, p->mode);
+  if (p->handle == nullptr) {
+    // dlerror() is per-thread, so it has to be read here
+    const char* err = dlerror();
+    p->err = err != nullptr ? err : "unknown dlopen() error";
+    return;
+  }
+
+  p->addresses.reserve(p->symbols.size());
+  for (const std::string& symbol : p->symbols) {
+    p->addresses.push_back(dlsym(p->handle, symbol.c_str()));
+  }
+}
+
+/*
+ * Called on the JS thread after Work() has completed.
+ */
+
+void AsyncDlopen::Finish(uv_work_t* req, int status) {
+  AsyncDlopen* p = reinterpret_cast<AsyncDlopen*>(req->data);
+  Env env = p->env;
+  HandleScope scope(env);
+
+  Value argv[] = { env.Null(), env.Null(), env.Null() };
+  if (p->handle == nullptr) {
+    argv[0] = String::New(env, p->err);
+  } else {
+    Array addresses = Array::New(env, p->addresses.size());
+    for (size_t i = 0; i < p->addresses.size(); i++) {
+      void* address = p->addresses[i];
+      addresses.Set(i, address == nullptr ? env.Null() : Value(WrapPointer(env, address)));
+    }
+    argv[1] = WrapPointer(env, p->handle);
+    argv[2] = addresses;
+  }
+
+  p->callback.MakeCallback(Object::New(env), { argv[0], argv[1], argv[2] });
+
+  delete p;
+}
+
+}
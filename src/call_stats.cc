@@ -0,0 +1,78 @@
+#include "ffi.h"
+
+namespace FFI {
+
+CallStats::CallStats(uint64_t threshold_ns, uint64_t min_samples)
+  : thresholdNs(threshold_ns), minSamples(min_samples), offloaded(false) {
+}
+
+void CallStats::Record(uint64_t ns) {
+  execTime.Record(ns);
+  if (!offloaded && execTime.count >= minSamples &&
+      execTime.Percentile(0.99) > thresholdNs) {
+    offloaded = true;
+  }
+}
+
+static CallStats* Unwrap(const Napi::CallbackInfo& args) {
+  if (!args[0].IsExternal()) {
+    throw TypeError::New(args.Env(), "CallStats External expected");
+  }
+  return args[0].As<External<CallStats>>().Data();
+}
+
+/*
+ * args[0] - Number - the p99 threshold, in milliseconds
+ * args[1] - Number - the number of samples to collect before deciding
+ *
+ * returns an External wrapping a new `CallStats`
+ */
+
+Value CallStats::New(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+
+  double threshold = args[0].ToNumber().DoubleValue();
+  int64_t min_samples = args[1].ToNumber().Int64Value();
+  if (!(threshold >= 0)) {
+    throw RangeError::New(env, "threshold must be a non-negative number");
+  }
+  if (min_samples < 1) {
+    throw RangeError::New(env, "minSamples must be a positive integer");
+  }
+
+  CallStats* stats = new CallStats(static_cast<uint64_t>(threshold * 1e6),
+                                   static_cast<uint64_t>(min_samples));
+  return External<CallStats>::New(env, stats, [](Env env, CallStats* stats) {
+    delete stats;
+  });
+}
+
+/*
+ * args[0] - External - the `CallStats`
+ *
+ * returns `{ threshold, minSamples, offloaded, execTime }`
+ */
+
+Value CallStats::Stats(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  CallStats* stats = Unwrap(args);
+
+  Object o = Object::New(env);
+  o["threshold"] = Number::New(env, stats->thresholdNs / 1e6);
+  o["minSamples"] = Number::New(env, static_cast<double>(stats->minSamples));
+  o["offloaded"] = Boolean::New(env, stats->offloaded);
+  o["execTime"] = stats->execTime.ToObject(env);
+  return o;
+}
+
+/*
+ * args[0] - External - the `CallStats`
+ *
+ * returns whether promise-style calls should run on the thread pool
+ */
+
+Value CallStats::Offloaded(const Napi::CallbackInfo& args) {
+  return Boolean::New(args.Env(), Unwrap(args)->offloaded);
+}
+
+}
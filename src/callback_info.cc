@@ -2,22 +2,129 @@
 // Reference:
 //   http://www.bufferoverflow.ch/cgi-bin/dwww/usr/share/doc/libffi5/html/The-Closure-API.html
 
+#include <cmath>
+#include <cstring>
+#include <thread>
 #include "ffi.h"
 
 namespace FFI {
 
+// upper bound of released closures kept for reuse per env
+static const size_t kMaxPooledClosures = 256;
+
+// the size, and for the integer ones the range, of each CallbackInfo::NativeKind
+static const size_t kKindSizes[] = { 0, 1, 1, 2, 2, 4, 4, 8, 8, 4, 8, 1, sizeof(void*) };
+static const double kKindMin[] = { 0, INT8_MIN, 0, INT16_MIN, 0, INT32_MIN, 0 };
+static const double kKindMax[] = { 0, INT8_MAX, UINT8_MAX, INT16_MAX, UINT16_MAX, INT32_MAX, UINT32_MAX };
+
+// callbacks with up to this many arguments don't allocate them on the heap
+static const unsigned kMaxStackArgs = 16;
+
 /*
  * Called when the `ffi_closure *` pointer (actually the "code" pointer) get's
- * GC'd on the JavaScript side. In this case we have to unwrap the
- * `callback_info *` struct, dispose of the JS function Persistent reference,
- * then finally free the struct.
+ * GC'd on the JavaScript side. Releases the closure, unless `free()` already
+ * did and it has been reused for another callback since.
+ */
+
+void closure_pointer_cb(Env env, char* code, uint64_t* generation) {
+  InstanceData* data = InstanceData::Get(env);
+  auto it = data->live_closures.find(code);
+  if (it != data->live_closures.end() && it->second.generation == *generation) {
+    CallbackInfo::Release(data, code);
+  }
+  delete generation;
+}
+
+/*
+ * Releases the closure of a live callback, either from its Buffer's finalizer
+ * or from an explicit `free()`.
+ */
+
+void CallbackInfo::Release(InstanceData* data, void* code) {
+  auto it = data->live_closures.find(code);
+  callback_info* info = it->second.info;
+  data->live_closures.erase(it);
+
+  // non-blocking invokations still queued keep the closure data alive,
+  // the last one to be dispatched recycles it in ReleaseQueued()
+  if (info->pending.load() > 0) {
+    info->released = true;
+    return;
+  }
+  Recycle(info);
+}
+
+/*
+ * Disposes of the JS function references, then hands the closure to the
+ * slab of its `ffi_cif *`, where it stays prepared for the next callback
+ * with the same signature. `ffi_closure_alloc()` takes libffi's global lock
+ * and maps executable pages, so this makes short-lived callbacks cheap.
  */
 
-void closure_pointer_cb(Env env, char* data, callback_info* hint) {
-  callback_info* info = static_cast<callback_info*>(hint);
-  // now we can free the closure data
+void CallbackInfo::Recycle(callback_info* info) {
+  InstanceData* data = info->instance_data;
+  ffi_cif* cif = info->closure.cif;
+  ObjectReference cifBuffer = std::move(info->cifBuffer);
   info->~callback_info();
-  ffi_closure_free(info);
+
+  if (data->pooled_closures >= kMaxPooledClosures || cifBuffer.IsEmpty()) {
+    ffi_closure_free(info);
+    return;
+  }
+
+  ClosureSlab& slab = data->closure_slabs[cif];
+  if (slab.cif.IsEmpty()) {
+    slab.cif = std::move(cifBuffer);
+  }
+  slab.closures.push_back(info);
+  data->pooled_closures++;
+}
+
+/*
+ * Takes a closure out of the slabs. `prepared` tells whether it's already
+ * prepared for `cif`; if there's none for `cif`, one of another signature
+ * is returned, which still saves the `ffi_closure_alloc()`.
+ */
+
+callback_info* CallbackInfo::TakePooled(InstanceData* data, ffi_cif* cif, bool* prepared) {
+  if (data->pooled_closures == 0) {
+    return nullptr;
+  }
+
+  auto it = data->closure_slabs.find(cif);
+  *prepared = it != data->closure_slabs.end();
+  if (!*prepared) {
+    it = data->closure_slabs.begin();  // empty slabs get erased
+  }
+
+  callback_info* info = it->second.closures.back();
+  it->second.closures.pop_back();
+  data->pooled_closures--;
+  if (it->second.closures.empty()) {
+    data->closure_slabs.erase(it);
+  }
+  return info;
+}
+
+/*
+ * args[0] - Buffer - the callback's code pointer, as returned by `Callback()`
+ *
+ * returns whether the callback was still live
+ */
+
+Value CallbackInfo::Free(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsBuffer()) {
+    throw TypeError::New(env, "callback_free() requires a Buffer argument");
+  }
+
+  InstanceData* data = InstanceData::Get(env);
+  void* code = GetBufferData<void>(args[0]);
+  if (data->live_closures.find(code) == data->live_closures.end()) {
+    return Boolean::New(env, false);
+  }
+  Release(data, code);
+  return Boolean::New(env, true);
 }
 
 /*
@@ -41,12 +148,15 @@ void CallbackInfo::DispatchToV8(callback_info* info, void* retval, void** parame
       } else {
         throw Error::New(env, errorMessage);
       }
+    } else if (!info->nativeKinds.empty()) {
+      DispatchNative(info, retval, parameters, dispatched);
     } else {
       // invoke the registered callback function
-      Value e = info->function.MakeCallback(Object::New(env), {
+      napi_value args[] = {
         WrapPointer(env, retval, info->resultSize),
         WrapPointer(env, parameters, sizeof(char*) * info->argc)
-      });
+      };
+      Value e = CallFunction(info, dispatched, 2, args);
       if (!e.IsUndefined()) {
         if (dispatched) {
           info->errorFunction.Call({ e });
@@ -60,19 +170,311 @@ void CallbackInfo::DispatchToV8(callback_info* info, void* retval, void** parame
   }
 }
 
-void CallbackInfo::WatcherCallback(uv_async_t* w) {
-  InstanceData* data = static_cast<InstanceData*>(w->data);
-  uv_mutex_lock(&data->mutex);
+/*
+ * Calls the JS callback function. A callback invoked from within a sync
+ * `ffi_call()` (e.g. a `qsort()` comparator) is nested in JS code already,
+ * and a plain call is enough. Any other one, dispatched from the threadsafe
+ * function or invoked by native code from the event loop, is a top-level
+ * call needing MakeCallback(), with its async_hooks bookkeeping and
+ * microtask checkpoint.
+ */
+
+Value CallbackInfo::CallFunction(callback_info* info, bool dispatched, size_t argc, const napi_value* args) {
+  InstanceData* data = info->instance_data;
+  if (dispatched || data->call_depth == 0) {
+    return info->function.MakeCallback(Object::New(data->env), argc, args);
+  }
+  return info->function.Call(data->env.Undefined(), argc, args);
+}
+
+/*
+ * Invokes the JS callback function of a callback whose argument and return
+ * types are all scalars or pointers, converting them natively instead of
+ * through Buffers and the "type" objects' get() and set().
+ */
+
+void CallbackInfo::DispatchNative(callback_info* info, void* retval, void** parameters, bool dispatched) {
+  Env env = info->instance_data->env;
+  unsigned argc = static_cast<unsigned>(info->argc);
+
+  napi_value stackArgs[kMaxStackArgs];
+  std::vector<napi_value> heapArgs;
+  napi_value* args = stackArgs;
+  if (argc > kMaxStackArgs) {
+    heapArgs.resize(argc);
+    args = heapArgs.data();
+  }
+
+  try {
+    for (unsigned i = 0; i < argc; i++) {
+      args[i] = UnmarshalArgument(info, i, parameters[i]);
+    }
+
+    Value result = CallFunction(info, dispatched, argc, args);
+    try {
+      MarshalResult(env, info->nativeKinds[argc], result, retval);
+    } catch (Error& e) {
+      e.Set("message", String::New(env, "error setting return value - " + e.Message()));
+      throw;
+    }
+  } catch (Error& e) {
+    if (dispatched) {
+      info->errorFunction.Call({ e.Value() });
+    } else {
+      e.ThrowAsJavaScriptException();
+    }
+  }
+}
+
+/*
+ * Returns the JS value of the `index`th argument, what the "type" object's
+ * get() would return. Pointers become Buffers tagged with the deref'd type.
+ */
+
+napi_value CallbackInfo::UnmarshalArgument(callback_info* info, unsigned index, void* arg) {
+  Env env = info->instance_data->env;
+  switch (info->nativeKinds[index]) {
+    case KIND_INT8: return Number::New(env, *static_cast<int8_t*>(arg));
+    case KIND_UINT8: return Number::New(env, *static_cast<uint8_t*>(arg));
+    case KIND_INT16: return Number::New(env, *static_cast<int16_t*>(arg));
+    case KIND_UINT16: return Number::New(env, *static_cast<uint16_t*>(arg));
+    case KIND_INT32: return Number::New(env, *static_cast<int32_t*>(arg));
+    case KIND_UINT32: return Number::New(env, *static_cast<uint32_t*>(arg));
+    case KIND_INT64: return BigInt::New(env, *static_cast<int64_t*>(arg));
+    case KIND_UINT64: return BigInt::New(env, *static_cast<uint64_t*>(arg));
+    case KIND_FLOAT: return Number::New(env, *static_cast<float*>(arg));
+    case KIND_DOUBLE: return Number::New(env, *static_cast<double*>(arg));
+    case KIND_BOOL: return Boolean::New(env, *static_cast<uint8_t*>(arg) != 0);
+    case KIND_POINTER: {
+      Object buf = Value(env, info->instance_data->WrapPointer(
+          *static_cast<char**>(arg), info->nativeSizes[index])).As<Object>();
+      buf.Set("type", info->nativeTypes.Value().Get(index));
+      return buf;
+    }
+  }
+  return env.Undefined();
+}
+
+/*
+ * Writes the JS callback function's return value to `retval`, with the
+ * checks of the "type" object's set(). Integers are widened to `ffi_arg`,
+ * as libffi expects of closures.
+ */
+
+void CallbackInfo::MarshalResult(Env env, uint8_t kind, Value result, void* retval) {
+  switch (kind) {
+    case KIND_VOID:
+      return;
+    case KIND_INT8:
+    case KIND_UINT8:
+    case KIND_INT16:
+    case KIND_UINT16:
+    case KIND_INT32:
+    case KIND_UINT32: {
+      double value = result.ToNumber().DoubleValue();
+      if (value < kKindMin[kind] || value > kKindMax[kind]) {
+        throw RangeError::New(env, "The value of \"value\" is out of range. It must be >= " +
+            std::to_string(static_cast<int64_t>(kKindMin[kind])) + " and <= " +
+            std::to_string(static_cast<int64_t>(kKindMax[kind])) + ". Received " +
+            result.ToString().Utf8Value());
+      }
+      int64_t integer = std::isnan(value) ? 0 : static_cast<int64_t>(value);
+      switch (kind) {
+        case KIND_INT8: *static_cast<ffi_sarg*>(retval) = static_cast<int8_t>(integer); break;
+        case KIND_UINT8: *static_cast<ffi_arg*>(retval) = static_cast<uint8_t>(integer); break;
+        case KIND_INT16: *static_cast<ffi_sarg*>(retval) = static_cast<int16_t>(integer); break;
+        case KIND_UINT16: *static_cast<ffi_arg*>(retval) = static_cast<uint16_t>(integer); break;
+        case KIND_INT32: *static_cast<ffi_sarg*>(retval) = static_cast<int32_t>(integer); break;
+        default: *static_cast<ffi_arg*>(retval) = static_cast<uint32_t>(integer); break;
+      }
+      return;
+    }
+    case KIND_INT64:
+    case KIND_UINT64: {
+      if (!result.IsBigInt()) {
+        throw TypeError::New(env, "Cannot mix BigInt and other types, use explicit conversions");
+      }
+      bool lossless;
+      if (kind == KIND_INT64) {
+        *static_cast<int64_t*>(retval) = result.As<BigInt>().Int64Value(&lossless);
+      } else {
+        *static_cast<uint64_t*>(retval) = result.As<BigInt>().Uint64Value(&lossless);
+      }
+      if (!lossless) {
+        throw RangeError::New(env, "The value of \"value\" is out of range for a 64-bit integer. Received " +
+            result.ToString().Utf8Value() + "n");
+      }
+      return;
+    }
+    case KIND_FLOAT:
+      *static_cast<float*>(retval) = static_cast<float>(result.ToNumber().DoubleValue());
+      return;
+    case KIND_DOUBLE:
+      *static_cast<double*>(retval) = result.ToNumber().DoubleValue();
+      return;
+    case KIND_BOOL: {
+      int32_t value = result.ToNumber().Int32Value();
+      if (value < 0 || value > UINT8_MAX) {
+        throw RangeError::New(env, "The value of \"value\" is out of range. It must be >= 0 and <= 255. Received " +
+            std::to_string(value));
+      }
+      *static_cast<ffi_arg*>(retval) = static_cast<uint8_t>(value);
+      return;
+    }
+    case KIND_POINTER:
+      if (result.IsNull()) {
+        *static_cast<char**>(retval) = nullptr;
+      } else if (result.IsBuffer()) {
+        *static_cast<char**>(retval) = GetBufferData<char>(result);
+      } else {
+        throw TypeError::New(env, "Buffer instance or null expected for a pointer");
+      }
+      return;
+  }
+}
+
+/*
+ * The `napi_threadsafe_function`'s `call_js` callback, invoked on the env's
+ * JS thread after an Enqueue() onto an empty queue.
+ */
+
+void CallbackInfo::WatcherCallback(napi_env env, napi_value js_callback, void* context, void* unused) {
+  if (env == nullptr) {
+    return;  // being finalized, see Abort()
+  }
+  InstanceData* data = static_cast<InstanceData*>(context);
+
+  // invokations of batched callbacks, delivered after the rest of each drain
+  std::vector<ThreadedCallbackInvokation*> batched;
+
+  // keep going until the queue stays empty, producers may push while we run
+  ThreadedCallbackInvokation* inv;
+  while ((inv = data->queue.TakeAll()) != nullptr) {
+    while (inv != nullptr) {
+      // the invokation is destroyed (or reused) by its thread once signalled
+      ThreadedCallbackInvokation* next = inv->m_next;
+      callback_info* info = inv->m_cbinfo;
+      switch (inv->m_kind) {
+        case ThreadedCallbackInvokation::BLOCKING:
+          DispatchToV8(info, inv->m_retval, inv->m_parameters, true);
+          inv->SignalDoneExecuting();
+          break;
+        case ThreadedCallbackInvokation::NON_BLOCKING:
+          if (!info->batchLayout.empty()) {
+            batched.push_back(inv);
+            break;
+          }
+          DispatchToV8(info, inv->m_retval, inv->m_parameters, true);
+          delete inv;
+          ReleaseQueued(info);
+          break;
+        case ThreadedCallbackInvokation::OVERFLOW:
+          delete inv;
+          ReportOverflow(info);
+          ReleaseQueued(info);
+          break;
+      }
+      inv = next;
+    }
+
+    if (!batched.empty()) {
+      DispatchBatches(batched);
+      batched.clear();
+    }
+  }
+}
+
+/*
+ * Delivers the batched invokations of a drain with one JS call per callback,
+ * keeping each callback's invokations in order.
+ */
+
+void CallbackInfo::DispatchBatches(std::vector<ThreadedCallbackInvokation*>& batched) {
+  std::vector<ThreadedCallbackInvokation*> batch;
+  for (size_t i = 0; i < batched.size(); i++) {
+    callback_info* info = batched[i] ? batched[i]->m_cbinfo : nullptr;
+    if (info == nullptr) {
+      continue;  // already part of an earlier batch
+    }
+
+    for (size_t j = i; j < batched.size(); j++) {
+      if (batched[j] != nullptr && batched[j]->m_cbinfo == info) {
+        batch.push_back(batched[j]);
+        batched[j] = nullptr;
+      }
+    }
+
+    DispatchBatchToV8(info, batch);
+    for (ThreadedCallbackInvokation* inv : batch) {
+      delete inv;
+      ReleaseQueued(info);
+    }
+    batch.clear();
+  }
+}
+
+/*
+ * Packs the arguments of all `batch` invokations into a single Buffer, laid
+ * out as in `batchLayout`, and invokes the JS callback function once with
+ * that Buffer and the number of tuples in it.
+ */
+
+void CallbackInfo::DispatchBatchToV8(callback_info* info, const std::vector<ThreadedCallbackInvokation*>& batch) {
+  Env env = info->instance_data->env;
+  HandleScope handle_scope(env);
+
+  if (info->function.IsEmpty() || info->function.Value().IsEmpty()) {
+    info->errorFunction.MakeCallback(Object::New(env), {
+      String::New(env, "ffi fatal: callback has been garbage collected!")
+    });
+    return;
+  }
 
-  while (!data->queue.empty()) {
-    ThreadedCallbackInvokation* inv = data->queue.front();
-    data->queue.pop();
+  ffi_cif* cif = info->closure.cif;
+  size_t stride = info->batchLayout[0];
+  Buffer<char> packed = Buffer<char>::New(env, stride * batch.size());
+  char* tuple = packed.Data();
+  for (ThreadedCallbackInvokation* inv : batch) {
+    for (unsigned i = 0; i < cif->nargs; i++) {
+      memcpy(tuple + info->batchLayout[i + 1], inv->m_parameters[i], cif->arg_types[i]->size);
+    }
+    tuple += stride;
+  }
 
-    DispatchToV8(inv->m_cbinfo, inv->m_retval, inv->m_parameters, true);
-    inv->SignalDoneExecuting();
+  Value e = info->function.MakeCallback(Object::New(env), {
+    packed,
+    Number::New(env, static_cast<double>(batch.size()))
+  });
+  if (!e.IsUndefined()) {
+    info->errorFunction.Call({ e });
   }
+}
+
+/*
+ * Tells the JS side how many invokations of a non-blocking callback with
+ * the "error" policy were dropped since the last report.
+ */
+
+void CallbackInfo::ReportOverflow(callback_info* info) {
+  Env env = info->instance_data->env;
+  HandleScope handle_scope(env);
+
+  info->overflowReported.store(false);
+  uint64_t dropped = info->dropped.exchange(0);
+  std::string message = "ffi: non-blocking callback queue is full, dropped " +
+      std::to_string(dropped) + " invocation(s)";
+  info->errorFunction.MakeCallback(Object::New(env), { String::New(env, message) });
+}
 
-  uv_mutex_unlock(&data->mutex);
+/*
+ * Called once per dispatched non-blocking invokation, recycles the closure
+ * if the callback was released in the meantime.
+ */
+
+void CallbackInfo::ReleaseQueued(callback_info* info) {
+  if (info->pending.fetch_sub(1) == 1 && info->released) {
+    Recycle(info);
+  }
 }
 
 /*
@@ -83,9 +485,9 @@ void CallbackInfo::WatcherCallback(uv_async_t* w) {
 Value CallbackInfo::Callback(const Napi::CallbackInfo& args) {
   Env env = args.Env();
 
-  if (args.Length() != 5 || !args[0].IsBuffer() ||
+  if (args.Length() < 5 || !args[0].IsBuffer() ||
       !args[3].IsFunction() || !args[4].IsFunction()) {
-    throw Error::New(env, "Signature: Buffer, int, int, Function, Function");
+    throw Error::New(env, "Signature: Buffer, int, int, Function, Function[, int, int, Array, Array, Array]");
   }
 
   // Args: cif pointer, JS function
@@ -96,10 +498,17 @@ Value CallbackInfo::Callback(const Napi::CallbackInfo& args) {
   Function callback = args[4].As<Function>();
 
   callback_info* cbInfo;
-  ffi_status status;
+  ffi_status status = FFI_OK;
   void* code;
+  InstanceData* data = InstanceData::Get(env);
 
-  void* storage = ffi_closure_alloc(sizeof(callback_info), &code);
+  bool prepared = false;
+  void* storage = TakePooled(data, cif, &prepared);
+  if (storage != nullptr) {
+    code = static_cast<callback_info*>(storage)->code;
+  } else {
+    storage = ffi_closure_alloc(sizeof(callback_info), &code);
+  }
   if (storage == nullptr) {
     throw Error::New(env, "ffi_closure_alloc() Returned Error");
   }
@@ -110,7 +519,61 @@ Value CallbackInfo::Callback(const Napi::CallbackInfo& args) {
   cbInfo->argc = argc;
   cbInfo->errorFunction = Reference<Function>::New(errorReportCallback, 1);
   cbInfo->function = Reference<Function>::New(callback, 1);
-  cbInfo->instance_data = InstanceData::Get(env);
+  cbInfo->instance_data = data;
+  cbInfo->gate = data->gate;
+  cbInfo->cifBuffer = Reference<Object>::New(args[0].As<Object>(), 1);
+  // optional: non-blocking queue size, and the CallbackInfo::OnFull policy
+  if (args[5].IsNumber()) {
+    cbInfo->queueSize = args[5].ToNumber().Uint32Value();
+    cbInfo->onFull = args[6].IsNumber() ? args[6].ToNumber().Int32Value() : ON_FULL_BLOCK;
+  }
+  // optional: `[stride, offset0, offset1, ...]` for batched delivery
+  if (cbInfo->queueSize > 0 && args[7].IsArray()) {
+    Array layout = args[7].As<Array>();
+    for (uint32_t i = 0; i < layout.Length(); i++) {
+      cbInfo->batchLayout.push_back(layout.Get(i).ToNumber().Uint32Value());
+    }
+    bool valid = cbInfo->batchLayout.size() == static_cast<size_t>(cif->nargs) + 1 &&
+        cbInfo->batchLayout[0] > 0;
+    for (unsigned i = 0; valid && i < cif->nargs; i++) {
+      valid = cbInfo->batchLayout[i + 1] + cif->arg_types[i]->size <= cbInfo->batchLayout[0];
+    }
+    if (!valid) {
+      cbInfo->~callback_info();
+      ffi_closure_free(cbInfo);
+      throw RangeError::New(env, "invalid batch layout for the callback's arguments");
+    }
+  }
+  // optional: the CallbackInfo::NativeKind of each argument and of the return
+  // value, and the "type" of pointer arguments' Buffers, for native marshalling
+  if (cbInfo->batchLayout.empty() && args[8].IsArray() && args[9].IsArray()) {
+    Array kinds = args[8].As<Array>();
+    Array types = args[9].As<Array>();
+    bool valid = kinds.Length() == static_cast<uint32_t>(cif->nargs) + 1 &&
+        static_cast<int>(cif->nargs) == argc;
+    for (uint32_t i = 0; valid && i < kinds.Length(); i++) {
+      uint32_t kind = kinds.Get(i).ToNumber().Uint32Value();
+      ffi_type* type = i < cif->nargs ? cif->arg_types[i] : cif->rtype;
+      valid = kind <= KIND_POINTER && kKindSizes[kind] == (kind == KIND_VOID ? 0 : type->size) &&
+          (kind != KIND_VOID || i == cif->nargs);
+      cbInfo->nativeKinds.push_back(static_cast<uint8_t>(kind));
+
+      size_t size = 0;
+      if (valid && kind == KIND_POINTER && i < cif->nargs) {
+        // a pointer to pointer gets a pointer sized Buffer, like `ref.get()`
+        Object deref = types.Get(i).As<Object>();
+        size = deref.Get("indirection").ToNumber().Int32Value() == 1 ?
+            deref.Get("size").ToNumber().Uint32Value() : sizeof(void*);
+      }
+      cbInfo->nativeSizes.push_back(size);
+    }
+    if (!valid) {
+      cbInfo->~callback_info();
+      ffi_closure_free(cbInfo);
+      throw RangeError::New(env, "invalid native kinds for the callback's signature");
+    }
+    cbInfo->nativeTypes = Reference<Object>::New(types, 1);
+  }
 
   // store a reference to the callback function pointer
   // (not sure if this is actually needed...)
@@ -118,24 +581,32 @@ Value CallbackInfo::Callback(const Napi::CallbackInfo& args) {
 
   //CallbackInfo *self = new CallbackInfo(callback, closure, code, argc);
 
-  status = ffi_prep_closure_loc(
-    &cbInfo->closure,
-    cif,
-    Invoke,
-    static_cast<void*>(cbInfo),
-    code
-  );
+  // a recycled closure of the same `ffi_cif *` is prepared already, and
+  // `user_data` is the closure itself
+  if (!prepared) {
+    status = ffi_prep_closure_loc(
+      &cbInfo->closure,
+      cif,
+      Invoke,
+      static_cast<void*>(cbInfo),
+      code
+    );
+  }
 
   if (status != FFI_OK) {
+    cbInfo->~callback_info();
     ffi_closure_free(cbInfo);
     Error e = Error::New(env, "ffi_prep_closure() Returned Error");
     e.Set("status", Number::New(env, status));
     throw e;
   }
 
+  uint64_t generation = ++data->closure_generation;
+  data->live_closures[code] = { cbInfo, generation };
+
   TypedArray ret = WrapPointer(env, code, sizeof(void*));
   ret.ArrayBuffer().
-      AddFinalizer(closure_pointer_cb, static_cast<char*>(code), cbInfo);
+      AddFinalizer(closure_pointer_cb, static_cast<char*>(code), new uint64_t(generation));
   return ret;
 }
 
@@ -149,38 +620,123 @@ void CallbackInfo::Invoke(ffi_cif* cif,
                           void** parameters,
                           void* user_data) {
   callback_info* info = static_cast<callback_info*>(user_data);
-  InstanceData* data = info->instance_data;
+  // not the InstanceData: the env may be gone by the time we get here
+  CallbackGate* gate = info->gate;
 #ifdef WIN32
-  if (data->thread == GetCurrentThreadId()) {
+  if (gate->thread == GetCurrentThreadId()) {
 #else
   // are we executing from another thread?
   uv_thread_t self_thread = uv_thread_self();
-  if (uv_thread_equal(&self_thread, &data->thread)) {
+  if (uv_thread_equal(&self_thread, &gate->thread)) {
 #endif
     DispatchToV8(info, retval, parameters);
   } else {
-    // hold the event loop open while this is executing
-    // TODO: REF()ING FROM A DIFFERENT IS AN INHERENT RACE CONDITION AND THIS
-    // CODE SHOULD NEVER HAVE BEEN WRITTEN
-    uv_ref(reinterpret_cast<uv_handle_t*>(&data->async));
-
-    // create a temporary storage area for our invokation parameters
-    std::unique_ptr<ThreadedCallbackInvokation> inv (
-        new ThreadedCallbackInvokation(info, retval, parameters));
+    if (info->queueSize > 0 && QueueNonBlocking(info, cif, parameters)) {
+      return;
+    }
 
-    // push it to the queue -- threadsafe
-    uv_mutex_lock(&data->mutex);
-    data->queue.push(inv.get());
-    uv_mutex_unlock(&data->mutex);
+    // this thread's storage area for our invokation parameters
+    ThreadedCallbackInvokation* inv = ThreadedCallbackInvokation::ForCurrentThread();
+    inv->Prepare(info, retval, parameters);
+    uint32_t spin_count = gate->spin_count.load(std::memory_order_relaxed);
 
-    // send a message to our main thread to wake up the WatchCallback loop
-    uv_async_send(&data->async);
+    // hand it over to the env's JS thread -- lock-free
+    if (!Enqueue(info, inv)) {
+      // the env is shutting down, there's no JS left to run
+      memset(retval, 0, info->resultSize);
+      return;
+    }
 
     // wait for signal from calling thread
-    inv->WaitForExecution();
+    inv->WaitForExecution(spin_count);
+  }
+}
+
+/*
+ * Pushes an invokation onto the queue of the env that created its closure,
+ * and wakes up that env's JS thread if the queue was empty. While it's not,
+ * a wakeup is already pending and the drain picks the invokation up too.
+ * Returns false once the env is shutting down.
+ *
+ * The thread counts itself in `producers` before checking `closing`, so
+ * that Abort() can't drain the queue, and the threadsafe function and the
+ * InstanceData can't go away, until the invokation is pushed and the wakeup
+ * is sent. Only the gate may be touched before that check.
+ */
 
-    uv_unref(reinterpret_cast<uv_handle_t*>(&data->async));
+bool CallbackInfo::Enqueue(callback_info* info, ThreadedCallbackInvokation* inv) {
+  CallbackGate* gate = info->gate;
+  gate->producers.fetch_add(1);
+  if (gate->closing.load()) {
+    gate->producers.fetch_sub(1);
+    return false;
   }
+  InstanceData* data = info->instance_data;
+  if (data->queue.Push(inv) &&
+      napi_call_threadsafe_function(data->tsfn, nullptr, napi_tsfn_nonblocking) != napi_ok) {
+    // no wakeup is coming, and none will while the queue isn't empty
+    gate->closing.store(true);
+    FailQueued(data);
+  }
+  gate->producers.fetch_sub(1);
+  return true;
+}
+
+/*
+ * Fails the blocking invokations of a queue that the JS thread can't be woken
+ * up to drain anymore, from a native thread: their threads get released with
+ * a zeroed return value. The others need the JS thread to be released, so
+ * they get queued again for Abort().
+ */
+
+void CallbackInfo::FailQueued(InstanceData* data) {
+  ThreadedCallbackInvokation* inv = data->queue.TakeAll();
+  while (inv != nullptr) {
+    ThreadedCallbackInvokation* next = inv->m_next;
+    if (inv->m_kind == ThreadedCallbackInvokation::BLOCKING) {
+      memset(inv->m_retval, 0, inv->m_cbinfo->resultSize);
+      inv->SignalDoneExecuting();
+    } else {
+      data->queue.Push(inv);
+    }
+    inv = next;
+  }
+}
+
+/*
+ * Queues a copy of the arguments of a non-blocking callback's invokation, so
+ * the calling thread can return right away. Returns false if the queue is
+ * full and the "block" policy says to fall back to a blocking invokation.
+ */
+
+bool CallbackInfo::QueueNonBlocking(callback_info* info, ffi_cif* cif, void** parameters) {
+  ThreadedCallbackInvokation* inv;
+
+  if (info->pending.fetch_add(1) < info->queueSize) {
+    inv = new ThreadedCallbackInvokation(info, cif, parameters);
+  } else {
+    info->pending.fetch_sub(1);
+    if (info->onFull == ON_FULL_BLOCK) {
+      return false;
+    }
+    if (info->onFull == ON_FULL_DROP) {
+      return true;
+    }
+
+    // ON_FULL_ERROR: keep at most one overflow report in the queue
+    info->dropped.fetch_add(1);
+    if (info->overflowReported.exchange(true)) {
+      return true;
+    }
+    info->pending.fetch_add(1);
+    inv = new ThreadedCallbackInvokation(info, cif, nullptr);
+  }
+
+  if (!Enqueue(info, inv)) {
+    delete inv;
+    info->pending.fetch_sub(1);
+  }
+  return true;
 }
 
 /*
@@ -191,21 +747,84 @@ Function CallbackInfo::Initialize(Env env) {
   Function fn = Function::New(env, Callback);
 
   InstanceData* instance_data = InstanceData::Get(env);
+  if (instance_data->tsfn != nullptr) {
+    return fn;  // already initialized for this env
+  }
+
   // initialize our threaded invokation stuff
 #ifdef WIN32
-  instance_data->thread = GetCurrentThreadId();
+  instance_data->gate->thread = GetCurrentThreadId();
 #else
-  instance_data->thread = uv_thread_self();
+  instance_data->gate->thread = uv_thread_self();
 #endif
-  uv_loop_t* loop = nullptr;
-  napi_get_uv_event_loop(env, &loop);
-  uv_async_init(loop, &instance_data->async, CallbackInfo::WatcherCallback);
-  instance_data->async.data = instance_data;
-  uv_mutex_init(&instance_data->mutex);
+  napi_status status = napi_create_threadsafe_function(
+      env, nullptr, nullptr, String::New(env, "ffi:Callback"),
+      0, 1, instance_data, Finalize, instance_data, WatcherCallback,
+      &instance_data->tsfn);
+  if (status != napi_ok) {
+    throw Error::New(env, "napi_create_threadsafe_function() failed");
+  }
 
   // allow the event loop to exit while this is running
-  uv_unref(reinterpret_cast<uv_handle_t*>(&instance_data->async));
+  napi_unref_threadsafe_function(env, instance_data->tsfn);
   return fn;
 }
 
+/*
+ * Releases the threads still waiting on, and frees the queued invokations
+ * of, an env that is shutting down. Called on the env's JS thread.
+ */
+
+void CallbackInfo::Abort(InstanceData* data) {
+  data->gate->closing.store(true);
+  // the threads that got past `closing` are about to push, see Enqueue()
+  while (data->gate->producers.load() != 0) {
+    std::this_thread::yield();
+  }
+
+  ThreadedCallbackInvokation* inv = data->queue.TakeAll();
+  while (inv != nullptr) {
+    ThreadedCallbackInvokation* next = inv->m_next;
+    callback_info* info = inv->m_cbinfo;
+    if (inv->m_kind == ThreadedCallbackInvokation::BLOCKING) {
+      memset(inv->m_retval, 0, info->resultSize);
+      inv->SignalDoneExecuting();
+    } else {
+      delete inv;
+      ReleaseQueued(info);
+    }
+    inv = next;
+  }
+}
+
+/*
+ * The `napi_threadsafe_function`'s finalizer. Depending on the order of the
+ * env's cleanup, this runs before or after InstanceData::Dispose().
+ */
+
+void CallbackInfo::Finalize(napi_env env, void* finalize_data, void* hint) {
+  InstanceData* data = static_cast<InstanceData*>(finalize_data);
+  Abort(data);
+  data->tsfn = nullptr;
+  if (data->disposed) {
+    delete data;
+  }
+}
+
+/*
+ * args[0] - Number - how many iterations a native thread invoking a callback
+ *                    busy-waits for the JS thread before going to sleep
+ */
+
+void CallbackInfo::SetSpinCount(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  int64_t spin_count = args[0].ToNumber().Int64Value();
+  if (spin_count < 0 || spin_count > UINT32_MAX) {
+    throw RangeError::New(env, "spin count must be a non-negative 32-bit integer");
+  }
+
+  InstanceData::Get(env)->gate->spin_count.store(
+      static_cast<uint32_t>(spin_count), std::memory_order_relaxed);
+}
+
 }
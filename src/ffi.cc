@@ -6,7 +6,10 @@
 
 namespace FFI {
 
-InstanceData::InstanceData(Env env_) : env(env_), pointer_to_orig_buffer() {
+InstanceData::InstanceData(Env env_)
+  : env(env_), pointer_to_orig_buffer(env_), stall_threshold(0), call_depth(0),
+    gate(new CallbackGate()), tsfn(nullptr), disposed(false),
+    closure_generation(0), pooled_closures(0) {
   Value buffer_ctor = env.Global()["Buffer"];
   Value buffer_from = buffer_ctor.As<Object>()["from"];
   this->buffer_from.Reset(buffer_from.As<Function>(), 1);
@@ -19,6 +22,13 @@ InstanceData::InstanceData(Env env_) : env(env_), pointer_to_orig_buffer() {
 }
 
 InstanceData::~InstanceData() {
+  for (auto& entry : closure_slabs) {
+    // like `buffer_from`, references can't be deleted from here
+    entry.second.cif.SuppressDestruct();
+    for (callback_info* info : entry.second.closures) {
+      ffi_closure_free(info);
+    }
+  }
 }
 
 InstanceData* InstanceData::Get(Env env) {
@@ -29,11 +39,14 @@ InstanceData* InstanceData::Get(Env env) {
 }
 
 void InstanceData::Dispose() {
-  uv_close(reinterpret_cast<uv_handle_t*>(&async), [](uv_handle_t* handle) {
-    InstanceData* self = static_cast<InstanceData*>(handle->data);
-    uv_mutex_destroy(&self->mutex);
-    delete self;
-  });
+  disposed = true;
+  if (tsfn == nullptr) {
+    delete this;
+    return;
+  }
+  // deleted by CallbackInfo::Finalize() once the threadsafe function is gone
+  CallbackInfo::Abort(this);
+  napi_release_threadsafe_function(tsfn, napi_tsfn_abort);
 }
 
 TypedArray WrapPointerImpl(Env env, char* ptr, size_t length) {
@@ -72,6 +85,21 @@ void FFI::InitializeBindings(Env env, Object target) {
   target["ffi_prep_cif_var"] = Function::New(env, FFIPrepCifVar);
   target["ffi_call"] = Function::New(env, FFICall);
   target["ffi_call_async"] = Function::New(env, FFICallAsync);
+  target["dlopen_async"] = Function::New(env, AsyncDlopen::Open);
+  target["callback_spin_count"] = Function::New(env, CallbackInfo::SetSpinCount);
+  target["callback_free"] = Function::New(env, CallbackInfo::Free);
+  target["stall_watchdog_init"] = Function::New(env, StallWatchdogInit);
+  target["stall_watchdog_threshold"] = Function::New(env, StallWatchdogThreshold);
+  target["async_limiter_new"] = Function::New(env, AsyncCallLimiter::New);
+  target["async_limiter_stats"] = Function::New(env, AsyncCallLimiter::Stats);
+  target["call_stats_new"] = Function::New(env, CallStats::New);
+  target["call_stats"] = Function::New(env, CallStats::Stats);
+  target["call_stats_offloaded"] = Function::New(env, CallStats::Offloaded);
+  target["native_callback_new"] = Function::New(env, NativeCallback::New);
+  target["native_callback_pointer"] = Function::New(env, NativeCallback::Pointer);
+  target["native_callback_contents"] = Function::New(env, NativeCallback::Contents);
+  target["native_callback_count"] = Function::New(env, NativeCallback::Count);
+  target["native_callback_reset"] = Function::New(env, NativeCallback::Reset);
 
   // `ffi_status` enum values
   SET_ENUM_VALUE(FFI_OK);
@@ -193,10 +221,10 @@ Value FFI::FFIPrepCif(const Napi::CallbackInfo& args) {
   if (!args[3].IsBuffer())
     throw TypeError::New(env, "prepCif(): Buffer required as atypes arg");
 
-  ffi_cif* cif = GetBufferData<ffi_cif>(args[0]);
+  ffi_cif* cif = PeekBufferData<ffi_cif>(args[0]);
   uint32_t nargs = args[1].ToNumber();
-  ffi_type* rtype = GetBufferData<ffi_type>(args[2]);
-  ffi_type** atypes = GetBufferData<ffi_type*>(args[3]);
+  ffi_type* rtype = PeekBufferData<ffi_type>(args[2]);
+  ffi_type** atypes = PeekBufferData<ffi_type*>(args[3]);
   ffi_abi abi = static_cast<ffi_abi>(args[4].ToNumber().Int32Value());
 
   ffi_status status = ffi_prep_cif(cif, abi, nargs, rtype, atypes);
@@ -227,11 +255,11 @@ Value FFI::FFIPrepCifVar(const Napi::CallbackInfo& args) {
   if (!args[3].IsBuffer())
     throw TypeError::New(env, "prepCifVar(): Buffer required as atypes arg");
 
-  ffi_cif* cif = GetBufferData<ffi_cif>(args[0]);
+  ffi_cif* cif = PeekBufferData<ffi_cif>(args[0]);
   uint32_t fargs = args[1].ToNumber();
   uint32_t targs = args[2].ToNumber();
-  ffi_type* rtype = GetBufferData<ffi_type>(args[3]);
-  ffi_type** atypes = GetBufferData<ffi_type*>(args[4]);
+  ffi_type* rtype = PeekBufferData<ffi_type>(args[3]);
+  ffi_type** atypes = PeekBufferData<ffi_type*>(args[4]);
   ffi_abi abi = static_cast<ffi_abi>(args[5].ToNumber().Int32Value());
 
   ffi_status status = ffi_prep_cif_var(cif, abi, fargs, targs, rtype, atypes);
@@ -239,6 +267,33 @@ Value FFI::FFIPrepCifVar(const Napi::CallbackInfo& args) {
   return Number::New(env, status);
 }
 
+// counts a sync `ffi_call()` in the JS thread's nesting depth while in scope
+struct CallDepthScope {
+  explicit CallDepthScope(InstanceData* data) : data(data) { data->call_depth++; }
+  ~CallDepthScope() { data->call_depth--; }
+  InstanceData* data;
+};
+
+// keeps the `errno` (and the Win32 last error) set by a foreign call while in
+// scope, for `ffi.errno()` to read once the JS run in between has returned
+struct PreserveErrno {
+  PreserveErrno() : saved(errno) {
+#ifdef WIN32
+    saved_last_error = GetLastError();
+#endif
+  }
+  ~PreserveErrno() {
+#ifdef WIN32
+    SetLastError(saved_last_error);
+#endif
+    errno = saved;
+  }
+  int saved;
+#ifdef WIN32
+  DWORD saved_last_error;
+#endif
+};
+
 /*
  * JS wrapper around `ffi_call()`.
  *
@@ -246,6 +301,7 @@ Value FFI::FFIPrepCifVar(const Napi::CallbackInfo& args) {
  * args[1] - Buffer - the C function pointer to invoke
  * args[2] - Buffer - the `void *` buffer big enough to hold the return value
  * args[3] - Buffer - the `void **` array of pointers containing the arguments
+ * args[4] - External - optional `CallStats` to record the execution time into
  */
 
 void FFI::FFICall(const Napi::CallbackInfo& args) {
@@ -255,17 +311,94 @@ void FFI::FFICall(const Napi::CallbackInfo& args) {
     throw TypeError::New(env, "ffi_call() requires 4 Buffer arguments!");
   }
 
-  ffi_cif* cif = GetBufferData<ffi_cif>(args[0]);
-  char* fn = GetBufferData<char>(args[1]);
-  char* res = GetBufferData<char>(args[2]);
-  void** fnargs = GetBufferData<void*>(args[3]);
+  ffi_cif* cif = PeekBufferData<ffi_cif>(args[0]);
+  char* fn = PeekBufferData<char>(args[1]);
+  char* res = PeekBufferData<char>(args[2]);
+  void** fnargs = PeekBufferData<void*>(args[3]);
   if (fn == nullptr) {
     throw TypeError::New(env, "funcPtr should not be nullptr!");
   } else if (*(const uint32_t *)fn == 0) {
     throw TypeError::New(env, "The content of funcPtr pointed are invalid(empty)!");
   }
 
+  CallStats* stats = nullptr;
+  if (args[4].IsExternal()) {
+    stats = args[4].As<External<CallStats>>().Data();
+  }
+  InstanceData* data = InstanceData::Get(env);
+  uint64_t threshold = data->stall_threshold;
+  CallDepthScope depth(data);
+
+  if (stats == nullptr && threshold == 0) {
+    ffi_call(cif, FFI_FN(fn), static_cast<void*>(res), fnargs);
+    return;
+  }
+
+  uint64_t start = uv_hrtime();
   ffi_call(cif, FFI_FN(fn), static_cast<void*>(res), fnargs);
+  PreserveErrno saved_errno;
+  uint64_t duration = uv_hrtime() - start;
+
+  if (stats != nullptr) {
+    stats->Record(duration);
+  }
+  if (threshold != 0 && duration >= threshold) {
+    ReportStall(env, args[1], duration);
+  }
+}
+
+/*
+ * Invokes the stall watchdog's JS callback synchronously, so that a stack
+ * trace taken there still shows the caller of the slow foreign function.
+ * FFICall() restores the call's `errno` once it has returned.
+ *
+ * fn - Buffer - the C function pointer, with the `name` set by `DynamicLibrary.get()`
+ * duration - the time spent inside `ffi_call()`, in nanoseconds
+ */
+
+void FFI::ReportStall(Env env, Value fn, uint64_t duration) {
+  InstanceData* data = InstanceData::Get(env);
+  if (data->stall_callback.IsEmpty()) {
+    return;
+  }
+
+  Value name = fn.As<Object>()["name"];
+  data->stall_callback.Call({
+    name,
+    Number::New(env, static_cast<double>(duration) / 1e6)
+  });
+}
+
+/*
+ * args[0] - Function - invoked as `fn(name, durationMs)` for every stalled call
+ */
+
+void FFI::StallWatchdogInit(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsFunction()) {
+    throw TypeError::New(env, "stall_watchdog_init() requires a function argument");
+  }
+
+  InstanceData* data = InstanceData::Get(env);
+  data->stall_callback.Reset(args[0].As<Function>(), 1);
+  // Same as `buffer_from`, the reference can't be reset from the InstanceData dtor.
+  args[0].As<Object>().AddFinalizer([](Env env, InstanceData* data) {
+    data->stall_callback.Reset();
+  }, data);
+}
+
+/*
+ * args[0] - Number - the stall threshold in milliseconds, 0 to disable the watchdog
+ */
+
+void FFI::StallWatchdogThreshold(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  double threshold = args[0].ToNumber().DoubleValue();
+  if (!(threshold >= 0)) {
+    throw RangeError::New(env, "threshold must be a non-negative number");
+  }
+
+  InstanceData::Get(env)->stall_threshold = static_cast<uint64_t>(threshold * 1e6);
 }
 
 /*
@@ -276,6 +409,8 @@ void FFI::FFICall(const Napi::CallbackInfo& args) {
  * args[2] - Buffer - the `void *` buffer big enough to hold the return value
  * args[3] - Buffer - the `void **` array of pointers containing the arguments
  * args[4] - Function - the callback function to invoke when complete
+ * args[5] - External - optional `AsyncCallLimiter` to queue the call behind
+ * args[6] - External - optional `CallStats` to record the execution time into
  */
 
 void FFI::FFICallAsync(const Napi::CallbackInfo& args) {
@@ -290,17 +425,32 @@ void FFI::FFICallAsync(const Napi::CallbackInfo& args) {
 
   // store a persistent references to all the Buffers and the callback function
   AsyncCallParams* p = new AsyncCallParams(env);
-  p->cif = GetBufferData<ffi_cif>(args[0]);
-  p->fn = GetBufferData<char>(args[1]);
-  p->res = GetBufferData<char>(args[2]);
-  p->argv = GetBufferData<void*>(args[3]);
+  p->cif = PeekBufferData<ffi_cif>(args[0]);
+  p->fn = PeekBufferData<char>(args[1]);
+  p->res = PeekBufferData<char>(args[2]);
+  p->argv = PeekBufferData<void*>(args[3]);
 
   p->result = FFI_OK;
   p->callback = Reference<Function>::New(args[4].As<Function>(), 1);
   p->req.data = p;
+  if (args[6].IsExternal()) {
+    p->stats = args[6].As<External<CallStats>>().Data();
+  }
+
+  if (args[5].IsExternal()) {
+    args[5].As<External<AsyncCallLimiter>>().Data()->Submit(p);
+  } else {
+    QueueAsyncFFICall(p);
+  }
+}
 
+/*
+ * Hands the prepared async call over to the thread pool.
+ */
+
+void FFI::QueueAsyncFFICall(AsyncCallParams* p) {
   uv_loop_t* loop = nullptr;
-  napi_get_uv_event_loop(env, &loop);
+  napi_get_uv_event_loop(p->env, &loop);
   uv_queue_work(loop,
                 &p->req,
                 FFI::AsyncFFICall,
@@ -322,7 +472,9 @@ void FFI::AsyncFFICall(uv_work_t* req) {
       p->err = "The content of funcPtr pointed are invalid(empty)!";
       p->result = FFI_BAD_ABI;
     } else {
+      uint64_t start = uv_hrtime();
       ffi_call(p->cif, FFI_FN(p->fn), p->res, p->argv);
+      p->exec_time = uv_hrtime() - start;
     }
   } catch (std::exception& e) {
     p->result = FFI_BAD_ABI;
@@ -345,6 +497,15 @@ void FFI::FinishAsyncFFICall(uv_work_t* req, int status) {
     argv[0] = String::New(env, p->err);
   }
 
+  // let the next queued call (if any) start while we're in JS-land
+  if (p->limiter != nullptr) {
+    p->limiter->Release();
+  }
+
+  if (p->stats != nullptr && p->result == FFI_OK) {
+    p->stats->Record(p->exec_time);
+  }
+
   // invoke the registered callback function
   // TODO: Track napi_async_context properly
   p->callback.MakeCallback(Object::New(env), argv);
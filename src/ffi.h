@@ -7,7 +7,10 @@
 #define __STDC_LIMIT_MACROS true
 #endif
 #include <stdint.h>
+#include <atomic>
+#include <mutex>
 #include <queue>
+#include <vector>
 #include <memory>
 #include <unordered_map>
 
@@ -30,6 +33,29 @@ namespace FFI {
 using namespace Napi;
 
 class InstanceData;
+struct CallbackGate;
+class AsyncCallLimiter;
+class CallStats;
+
+/*
+ * Log2-bucketed latency histogram. Cheap enough to update on every call, and
+ * percentiles are accurate to within a factor of two.
+ */
+
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    void Record(uint64_t ns);
+    uint64_t Percentile(double p) const;
+    Object ToObject(Env env) const;
+
+    uint64_t count;
+    uint64_t max;
+
+  private:
+    uint64_t m_buckets[64];
+};
 
 /*
  * Class used to store stuff during async ffi_call() invokations.
@@ -37,7 +63,8 @@ class InstanceData;
 
 class AsyncCallParams {
   public:
-    explicit AsyncCallParams(Env env_) : env(env_) {}
+    explicit AsyncCallParams(Env env_)
+      : env(env_), limiter(nullptr), queued_at(0), stats(nullptr), exec_time(0) {}
     Env env;
     ffi_status result;
     std::string err;
@@ -47,6 +74,124 @@ class AsyncCallParams {
     void** argv;
     FunctionReference callback;
     uv_work_t req;
+    AsyncCallLimiter* limiter;
+    uint64_t queued_at;
+    CallStats* stats;
+    uint64_t exec_time;
+};
+
+/*
+ * Caps the number of concurrent `ffi_call_async()` invokations of a single
+ * foreign function. Calls beyond the limit wait in FIFO order. Only ever
+ * touched from the JS thread, so no locking is needed.
+ */
+
+class AsyncCallLimiter {
+  public:
+    explicit AsyncCallLimiter(uint32_t max_concurrency);
+
+    void Submit(AsyncCallParams* p);
+    void Release();
+
+    static Value New(const Napi::CallbackInfo& args);
+    static Value Stats(const Napi::CallbackInfo& args);
+
+    uint32_t maxConcurrency;
+    uint32_t inFlight;
+    uint64_t completed;
+    std::queue<AsyncCallParams*> pending;
+    LatencyHistogram waitTime;
+};
+
+/*
+ * Native execution time of a single foreign function. Once enough samples
+ * have been seen and the p99 exceeds the threshold the function is flagged
+ * as "offloaded", meaning its promise-style calls go to the thread pool.
+ * The flag is sticky. Only ever touched from the JS thread.
+ */
+
+class CallStats {
+  public:
+    CallStats(uint64_t threshold_ns, uint64_t min_samples);
+
+    void Record(uint64_t ns);
+
+    static Value New(const Napi::CallbackInfo& args);
+    static Value Stats(const Napi::CallbackInfo& args);
+    static Value Offloaded(const Napi::CallbackInfo& args);
+
+    uint64_t thresholdNs;
+    uint64_t minSamples;
+    bool offloaded;
+    LatencyHistogram execTime;
+};
+
+/*
+ * `dlopen()` plus bulk `dlsym()` of a list of symbols, done on the thread
+ * pool so that loading a large library doesn't block the event loop.
+ */
+
+class AsyncDlopen {
+  public:
+    explicit AsyncDlopen(Env env_) : env(env_), handle(nullptr) {}
+
+    static void Open(const Napi::CallbackInfo& args);
+    static void Work(uv_work_t* req);
+    static void Finish(uv_work_t* req, int status);
+
+    Env env;
+    bool hasPath;
+    std::string path;
+    int mode;
+    std::vector<std::string> symbols;
+    void* handle;
+    std::vector<void*> addresses;
+    std::string err;
+    FunctionReference callback;
+    uv_work_t req;
+};
+
+/*
+ * A C function pointer implemented natively, for the callbacks common enough
+ * that a round trip to JS is pure overhead: `qsort()`/`bsearch()` style
+ * comparators, sinks collecting their arguments into a growable buffer,
+ * counters, and routers spreading calls over other function pointers.
+ */
+
+class NativeCallback {
+  public:
+    enum Kind { COMPARE_INT, COMPARE_UINT, COMPARE_FLOAT, COMPARE_BYTES, COLLECT, COUNT, ROUTE };
+
+    NativeCallback();
+    ~NativeCallback();
+
+    static Value New(const Napi::CallbackInfo& args);
+    static Value Pointer(const Napi::CallbackInfo& args);
+    static Value Contents(const Napi::CallbackInfo& args);
+    static Value Count(const Napi::CallbackInfo& args);
+    static void Reset(const Napi::CallbackInfo& args);
+
+    ffi_closure* closure;
+    void* code;                    // the executable function pointer
+    int kind;
+    size_t width;                  // size of the compared elements
+    size_t offset;                 // offset of the compared field within the elements
+    bool descending;
+    std::vector<uint32_t> layout;  // `[stride, offset0, offset1, ...]` of collected tuples
+    std::atomic<uint64_t> count;   // invokations since the last reset
+    std::mutex mutex;              // guards `data`, sinks may be called from any thread
+    std::vector<char> data;
+    // a router's table: the addresses of its `targetCount` targets (0 for
+    // one not published yet), then its closed flag and its count of calls
+    // in flight. Owned, or the memory of a SharedArrayBuffer
+    std::atomic<uint64_t>* table;
+    std::unique_ptr<std::atomic<uint64_t>[]> ownedTable;
+    size_t targetCount;
+    int keyIndex;                  // argument picking a router's target, -1 for round-robin
+
+  private:
+    static void Invoke(ffi_cif* cif, void* retval, void** parameters, void* user_data);
+    static int Compare(NativeCallback* self, const char* a, const char* b);
 };
 
 class FFI {
@@ -54,11 +199,17 @@ class FFI {
     static Object InitializeStaticFunctions(Env env);
     static void InitializeBindings(Env env, Object target);
 
+    friend class AsyncCallLimiter;
+
   protected:
     static Value FFIPrepCif(const Napi::CallbackInfo& args);
     static Value FFIPrepCifVar(const Napi::CallbackInfo& args);
     static void FFICall(const Napi::CallbackInfo& args);
+    static void ReportStall(Env env, Value fn, uint64_t duration);
+    static void StallWatchdogInit(const Napi::CallbackInfo& args);
+    static void StallWatchdogThreshold(const Napi::CallbackInfo& args);
     static void FFICallAsync(const Napi::CallbackInfo& args);
+    static void QueueAsyncFFICall(AsyncCallParams* p);
     static void AsyncFFICall(uv_work_t* req);
     static void FinishAsyncFFICall(uv_work_t* req, int status);
 };
@@ -67,11 +218,14 @@ class FFI {
  * One of these structs gets created for each `ffi.Callback()` invokation in
  * JavaScript-land. It contains all the necessary information when invoking the
  * pointer to proxy back to JS-land properly. It gets created by
- * `ffi_closure_alloc()`, and free'd in the closure_pointer_cb function.
+ * `ffi_closure_alloc()` (or taken from a ClosureSlab), and released in the
+ * closure_pointer_cb function or by an explicit `free()`.
  */
 
 struct callback_info {
-  callback_info() {
+  callback_info()
+    : queueSize(0), onFull(0), pending(0), dropped(0),
+      overflowReported(false), released(false) {
   }
 
   ffi_closure closure;           // the actual `ffi_closure` instance get inlined
@@ -82,6 +236,38 @@ struct callback_info {
   int argc;                      // the number of arguments this function expects
   size_t resultSize;             // the size of the result pointer
   InstanceData* instance_data;
+  CallbackGate* gate;            // the env's, which outlives `instance_data`
+  // non-blocking mode, where calls from other threads only queue a copy of the arguments
+  uint32_t queueSize;            // max queued invokations, 0 for a blocking callback
+  int onFull;                    // CallbackInfo::OnFull policy once `queueSize` is reached
+  std::atomic<uint32_t> pending; // queued invokations not dispatched yet
+  std::atomic<uint64_t> dropped; // invokations dropped since the last overflow report
+  std::atomic<bool> overflowReported;
+  bool released;                 // GC'd while invokations were still queued
+  // batched mode: `[stride, offset0, offset1, ...]` of the packed argument
+  // tuples a whole drain's invokations get delivered in, empty otherwise
+  std::vector<uint32_t> batchLayout;
+  ObjectReference cifBuffer;     // the `ffi_cif *` Buffer the closure is prepared for
+  // native marshalling: the CallbackInfo::NativeKind of each argument, then of
+  // the return value; empty when the JS wrapper converts them instead
+  std::vector<uint8_t> nativeKinds;
+  std::vector<size_t> nativeSizes;    // length of the Buffer each pointer argument gets wrapped in
+  ObjectReference nativeTypes;        // Array of the "type" each pointer argument's Buffer gets
+};
+
+/*
+ * Released closures already prepared for one `ffi_cif *`, see
+ * CallbackInfo::Recycle().
+ */
+
+struct ClosureSlab {
+  ObjectReference cif;           // keeps the `ffi_cif *` the closures point to alive
+  std::vector<callback_info*> closures;
+};
+
+struct LiveClosure {
+  callback_info* info;
+  uint64_t generation;           // tells a reused closure from the one a stale Buffer wrapped
 };
 
 class ThreadedCallbackInvokation;
@@ -89,11 +275,35 @@ class ThreadedCallbackInvokation;
 class CallbackInfo {
   public:
     static Function Initialize(Env env);
-    static void WatcherCallback(uv_async_t* w);
+    static void WatcherCallback(napi_env env, napi_value js_callback, void* context, void* unused);
+    static void Finalize(napi_env env, void* finalize_data, void* hint);
+    static void Abort(InstanceData* data);
+    static void SetSpinCount(const Napi::CallbackInfo& args);
+    static Value Free(const Napi::CallbackInfo& args);
+    static void Release(InstanceData* data, void* code);
+    static void Recycle(callback_info* info);
+
+    enum OnFull { ON_FULL_BLOCK, ON_FULL_DROP, ON_FULL_ERROR };
+    enum NativeKind {
+      KIND_VOID, KIND_INT8, KIND_UINT8, KIND_INT16, KIND_UINT16, KIND_INT32, KIND_UINT32,
+      KIND_INT64, KIND_UINT64, KIND_FLOAT, KIND_DOUBLE, KIND_BOOL, KIND_POINTER
+    };
 
   protected:
     static void DispatchToV8(callback_info* self, void* retval, void** parameters, bool dispatched = false);
     static void Invoke(ffi_cif* cif, void* retval, void** parameters, void* user_data);
+    static Value CallFunction(callback_info* info, bool dispatched, size_t argc, const napi_value* args);
+    static void DispatchNative(callback_info* info, void* retval, void** parameters, bool dispatched);
+    static napi_value UnmarshalArgument(callback_info* info, unsigned index, void* arg);
+    static void MarshalResult(Env env, uint8_t kind, Value result, void* retval);
+    static callback_info* TakePooled(InstanceData* data, ffi_cif* cif, bool* prepared);
+    static bool Enqueue(callback_info* info, ThreadedCallbackInvokation* inv);
+    static void FailQueued(InstanceData* data);
+    static bool QueueNonBlocking(callback_info* info, ffi_cif* cif, void** parameters);
+    static void ReportOverflow(callback_info* info);
+    static void ReleaseQueued(callback_info* info);
+    static void DispatchBatches(std::vector<ThreadedCallbackInvokation*>& batched);
+    static void DispatchBatchToV8(callback_info* info, const std::vector<ThreadedCallbackInvokation*>& batch);
     static Value Callback(const Napi::CallbackInfo& info);
 };
 
@@ -104,28 +314,131 @@ class CallbackInfo {
  *   -> WaitForExecution()     returned
  *
  *   ^WaitForExecution() must always be called from the thread which owns the object
+ *
+ *   Every native thread owns exactly one, reused for all of its callback
+ *   invokations (a thread is blocked for the duration of one), so a round
+ *   trip costs a semaphore post and wait only; and nothing at all when the
+ *   JS thread finishes within the optional spin phase.
  */
 
 class ThreadedCallbackInvokation {
   public:
-    ThreadedCallbackInvokation(callback_info* cbinfo, void* retval, void** parameters);
+    enum Kind { BLOCKING, NON_BLOCKING, OVERFLOW };
+
+    ThreadedCallbackInvokation();
+    // heap-allocated copy of a non-blocking invokation's arguments, or an
+    // overflow report if `parameters` is nullptr; deleted by the JS thread
+    ThreadedCallbackInvokation(callback_info* cbinfo, ffi_cif* cif, void** parameters);
     ~ThreadedCallbackInvokation();
 
+    static ThreadedCallbackInvokation* ForCurrentThread();
+
+    void Prepare(callback_info* cbinfo, void* retval, void** parameters);
     void SignalDoneExecuting();
-    void WaitForExecution();
+    void WaitForExecution(uint32_t spin_count);
 
+    Kind m_kind;
     void* m_retval;
     void** m_parameters;
     callback_info* m_cbinfo;
+    ThreadedCallbackInvokation* m_next;  // intrusive link for InvokationQueue
+
+  private:
+    enum State : uint32_t { PENDING, SLEEPING, DONE };
+
+    std::atomic<uint32_t> m_state;
+    uv_sem_t m_sem;
+    std::unique_ptr<char[]> m_storage;
+};
+
+/*
+ * Lock-free multi-producer, single-consumer queue of invokations waiting for
+ * the JS thread. Producers push onto an intrusive stack with a CAS loop; the
+ * JS thread detaches the whole stack at once and reverses it into FIFO
+ * order, so no lock is ever held while JS runs.
+ */
+
+class InvokationQueue {
+  public:
+    InvokationQueue() : m_head(nullptr) {}
+
+    // returns true if the queue was empty before the push
+    bool Push(ThreadedCallbackInvokation* inv);
+    // returns the oldest invokation, linked through `m_next`, or nullptr
+    ThreadedCallbackInvokation* TakeAll();
+
+  private:
+    std::atomic<ThreadedCallbackInvokation*> m_head;
+};
+
+/*
+ * The ArrayBuffers wrapping each address, so that wrapping an address twice
+ * returns views of the same ArrayBuffer instead of duplicates. Open-addressing
+ * table of weak references: a GC'd ArrayBuffer's entry reads as missing, and
+ * gets dropped lazily instead of by a finalizer per ArrayBuffer.
+ */
+
+class PointerMap {
+  public:
+    explicit PointerMap(napi_env env);
+
+    // the live ArrayBuffer registered for `ptr`, or an empty one; `external`
+    // tells whether it was created by WrapPointer() rather than by JS
+    ArrayBuffer Get(char* ptr, bool* external = nullptr);
+    // registers `ab` for `ptr`, in place of any previous ArrayBuffer
+    void Set(char* ptr, ArrayBuffer ab, bool external);
+    void Forget(char* ptr);
+    size_t Size() const { return m_count; }
 
   private:
-    uv_cond_t m_cond;
-    uv_mutex_t m_mutex;
+    struct Slot {
+      char* ptr;      // nullptr for an empty slot
+      napi_ref ab;
+      bool external;
+    };
+
+    size_t Home(char* ptr) const;
+    size_t Find(char* ptr) const;
+    void EraseAt(size_t i);
+    void Rehash();
+
+    napi_env m_env;
+    std::vector<Slot> m_slots;
+    size_t m_count;
 };
 
-struct ArrayBufferEntry {
-  Reference<ArrayBuffer> ab;
-  size_t finalizer_count;
+/*
+ * A `ref.allocNative()` allocation. Owned by its Buffer's finalizer, since
+ * `ref.free()` may release the memory long before the Buffer gets GC'd.
+ */
+
+struct NativeAllocation {
+  char* ptr;
+  size_t size;  // bytes reported to V8 as external memory
+  bool freed;
+};
+
+/*
+ * The state of an env that a native thread invoking one of its callbacks
+ * reads before it gets to touch the InstanceData, if ever. Leaked on purpose:
+ * such a thread may still be on its way in when the env gets torn down and
+ * its InstanceData deleted.
+ */
+
+struct CallbackGate {
+  CallbackGate() : closing(false), producers(0), spin_count(0) {}
+
+#ifdef WIN32
+  DWORD thread;
+#else
+  uv_thread_t thread;
+#endif
+  std::atomic<bool> closing;
+  // native threads between their check of `closing` and the end of their
+  // wakeup, which CallbackInfo::Abort() waits for
+  std::atomic<uint32_t> producers;
+  // iterations a native thread busy-waits for its callback before sleeping
+  std::atomic<uint32_t> spin_count;
 };
 
 class InstanceData final {
@@ -135,22 +448,37 @@ class InstanceData final {
 
   Env env;
 
-  std::unordered_map<char*, ArrayBufferEntry> pointer_to_orig_buffer;
+  PointerMap pointer_to_orig_buffer;
   FunctionReference buffer_from;
+  // the live `ref.allocNative()` allocations, by address
+  std::unordered_map<char*, NativeAllocation*> native_allocations;
+
+  // stall watchdog: sync `ffi_call()`s taking longer than `stall_threshold`
+  // nanoseconds (0 = disabled) get reported to `stall_callback`
+  uint64_t stall_threshold;
+  FunctionReference stall_callback;
+
+  // how many sync `ffi_call()`s the JS thread is inside of, see
+  // CallbackInfo::CallFunction()
+  uint32_t call_depth;
 
   void Dispose();
   napi_value WrapPointer(char* ptr, size_t length);
   char* GetBufferData(napi_value val);
   void RegisterArrayBuffer(napi_value val);
 
-#ifdef WIN32
-  DWORD thread;
-#else
-  uv_thread_t thread;
-#endif
-  uv_mutex_t mutex;
-  std::queue<ThreadedCallbackInvokation*> queue;
-  uv_async_t async;
+  CallbackGate* gate;
+  InvokationQueue queue;
+  // wakes up this env's JS thread to drain `queue`, see CallbackInfo::Enqueue()
+  napi_threadsafe_function tsfn;
+  bool disposed;
+
+  // closures of the live callbacks, by executable code pointer
+  std::unordered_map<void*, LiveClosure> live_closures;
+  uint64_t closure_generation;
+  // closures of freed callbacks, ready to be reused
+  std::unordered_map<ffi_cif*, ClosureSlab> closure_slabs;
+  size_t pooled_closures;
 
   static InstanceData* Get(Env env);
 };
@@ -168,4 +496,11 @@ inline T* GetBufferData(Value val) {
   return reinterpret_cast<T*>(GetBufferDataImpl(val));
 }
 
+// for Buffers whose address doesn't escape the call, so that it can't come
+// back through WrapPointer(): skips registering their ArrayBuffer
+template <typename T>
+inline T* PeekBufferData(Value val) {
+  return reinterpret_cast<T*>(val.As<Buffer<char>>().Data());
+}
+
 }
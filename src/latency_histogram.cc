@@ -0,0 +1,59 @@
+#include <string.h>
+
+#include "ffi.h"
+
+namespace FFI {
+
+static inline unsigned Log2(uint64_t v) {
+  unsigned r = 0;
+  while (v >>= 1) r++;
+  return r;
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), max(0) {
+  memset(m_buckets, 0, sizeof(m_buckets));
+}
+
+void LatencyHistogram::Record(uint64_t ns) {
+  m_buckets[Log2(ns | 1)]++;
+  count++;
+  if (ns > max) max = ns;
+}
+
+/*
+ * Returns the upper edge of the bucket holding the `p` quantile (0 < p <= 1),
+ * clamped to the largest value recorded so far.
+ */
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  if (count == 0) return 0;
+
+  uint64_t rank = static_cast<uint64_t>(p * count);
+  if (rank == 0) rank = 1;
+
+  uint64_t seen = 0;
+  for (unsigned b = 0; b < 64; b++) {
+    seen += m_buckets[b];
+    if (seen >= rank) {
+      uint64_t edge = b >= 63 ? UINT64_MAX : (uint64_t(1) << (b + 1)) - 1;
+      return edge < max ? edge : max;
+    }
+  }
+  return max;
+}
+
+/*
+ * Returns `{ count, p50, p90, p99, max }`, with the timings in milliseconds.
+ */
+
+Object LatencyHistogram::ToObject(Env env) const {
+  Object o = Object::New(env);
+  o["count"] = Number::New(env, static_cast<double>(count));
+  o["p50"] = Number::New(env, Percentile(0.50) / 1e6);
+  o["p90"] = Number::New(env, Percentile(0.90) / 1e6);
+  o["p99"] = Number::New(env, Percentile(0.99) / 1e6);
+  o["max"] = Number::New(env, max / 1e6);
+  return o;
+}
+
+}
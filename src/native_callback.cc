@@ -0,0 +1,291 @@
+#include <cstring>
+#include <thread>
+#include "ffi.h"
+
+namespace FFI {
+
+NativeCallback::NativeCallback()
+  : closure(nullptr), code(nullptr), kind(COUNT), width(0), offset(0),
+    descending(false), count(0), table(nullptr), targetCount(0), keyIndex(-1) {
+}
+
+NativeCallback::~NativeCallback() {
+  if (closure != nullptr) {
+    ffi_closure_free(closure);
+  }
+}
+
+template <typename T>
+static int CompareAs(const char* a, const char* b) {
+  T x, y;
+  memcpy(&x, a, sizeof(T));
+  memcpy(&y, b, sizeof(T));
+  return (x > y) - (x < y);
+}
+
+int NativeCallback::Compare(NativeCallback* self, const char* a, const char* b) {
+  a += self->offset;
+  b += self->offset;
+  switch (self->kind) {
+    case COMPARE_INT:
+      switch (self->width) {
+        case 1: return CompareAs<int8_t>(a, b);
+        case 2: return CompareAs<int16_t>(a, b);
+        case 4: return CompareAs<int32_t>(a, b);
+        default: return CompareAs<int64_t>(a, b);
+      }
+    case COMPARE_UINT:
+      switch (self->width) {
+        case 1: return CompareAs<uint8_t>(a, b);
+        case 2: return CompareAs<uint16_t>(a, b);
+        case 4: return CompareAs<uint32_t>(a, b);
+        default: return CompareAs<uint64_t>(a, b);
+      }
+    case COMPARE_FLOAT:
+      return self->width == 4 ? CompareAs<float>(a, b) : CompareAs<double>(a, b);
+    default:
+      return memcmp(a, b, self->width);
+  }
+}
+
+/*
+ * The closure's function, runs on whichever thread calls the pointer without
+ * ever entering JS.
+ */
+
+void NativeCallback::Invoke(ffi_cif* cif, void* retval, void** parameters, void* user_data) {
+  NativeCallback* self = static_cast<NativeCallback*>(user_data);
+  uint64_t invokation = self->count.fetch_add(1, std::memory_order_relaxed);
+
+  switch (self->kind) {
+    case COMPARE_INT:
+    case COMPARE_UINT:
+    case COMPARE_FLOAT:
+    case COMPARE_BYTES: {
+      int result = Compare(self, *static_cast<char**>(parameters[0]),
+                           *static_cast<char**>(parameters[1]));
+      *static_cast<ffi_sarg*>(retval) = self->descending ? -result : result;
+      return;
+    }
+    case COLLECT: {
+      std::lock_guard<std::mutex> lock(self->mutex);
+      size_t start = self->data.size();
+      self->data.resize(start + self->layout[0]);
+      for (unsigned i = 0; i < cif->nargs; i++) {
+        memcpy(&self->data[start + self->layout[i + 1]], parameters[i], cif->arg_types[i]->size);
+      }
+      return;
+    }
+    case ROUTE: {
+      // the key argument's bits pick the target, so equal keys stay in order
+      uint64_t n = invokation;
+      if (self->keyIndex >= 0) {
+        n = 0;
+        size_t size = cif->arg_types[self->keyIndex]->size;
+        memcpy(&n, parameters[self->keyIndex], size < sizeof(n) ? size : sizeof(n));
+        // mix the bits, aligned pointers would all pick the same few targets
+        n ^= n >> 33;
+        n *= 0xff51afd7ed558ccdULL;
+        n ^= n >> 33;
+      }
+      std::atomic<uint64_t>& closed = self->table[self->targetCount];
+      std::atomic<uint64_t>& active = self->table[self->targetCount + 1];
+      std::atomic<uint64_t>& slot = self->table[n % self->targetCount];
+
+      // counted before checking `closed`: whoever closes the router waits
+      // for the calls in flight before freeing the targets
+      active.fetch_add(1);
+      uint64_t target = 0;
+      while (closed.load() == 0 && (target = slot.load()) == 0) {
+        std::this_thread::yield();  // the target is still starting up
+      }
+      if (closed.load() == 0) {
+        ffi_call(cif, FFI_FN(reinterpret_cast<void*>(static_cast<uintptr_t>(target))), retval, parameters);
+      } else if (cif->rtype->size > 0) {
+        memset(retval, 0, cif->rtype->size < sizeof(ffi_arg) ? sizeof(ffi_arg) : cif->rtype->size);
+      }
+      active.fetch_sub(1);
+      return;
+    }
+    default:
+      if (cif->rtype->size > 0) {
+        memset(retval, 0, cif->rtype->size < sizeof(ffi_arg) ? sizeof(ffi_arg) : cif->rtype->size);
+      }
+      return;
+  }
+}
+
+static NativeCallback* Unwrap(const Napi::CallbackInfo& args) {
+  if (!args[0].IsExternal()) {
+    throw TypeError::New(args.Env(), "NativeCallback External expected");
+  }
+  return args[0].As<External<NativeCallback>>().Data();
+}
+
+/*
+ * args[0] - Buffer - the `ffi_cif *` of the callback's signature
+ * args[1] - Number - the NativeCallback::Kind
+ * args[2] - Number - comparators: the size of the compared field
+ * args[3] - Number - comparators: the offset of the compared field
+ * args[4] - Boolean - comparators: whether to sort in descending order
+ * args[5] - Array - sinks: `[stride, offset0, offset1, ...]` of the tuples,
+ *                   routers: the target function pointers, as Buffers or BigInts,
+ *                   or a BigUint64Array on a SharedArrayBuffer, see `table`
+ * args[6] - Number - routers: the index of the key argument, -1 for round-robin
+ *
+ * returns an External wrapping a new `NativeCallback`
+ */
+
+Value NativeCallback::New(const Napi::CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsBuffer()) {
+    throw TypeError::New(env, "native_callback_new() requires a CIF Buffer");
+  }
+  ffi_cif* cif = GetBufferData<ffi_cif>(args[0]);
+  int kind = args[1].ToNumber().Int32Value();
+
+  std::unique_ptr<NativeCallback> self(new NativeCallback());
+  self->kind = kind;
+
+  if (kind >= COMPARE_INT && kind <= COMPARE_BYTES) {
+    if (cif->nargs != 2 || cif->arg_types[0]->type != FFI_TYPE_POINTER ||
+        cif->arg_types[1]->type != FFI_TYPE_POINTER || cif->rtype->size != sizeof(int)) {
+      throw TypeError::New(env, "comparators must have the signature int (*)(const void*, const void*)");
+    }
+    int64_t width = args[2].ToNumber().Int64Value();
+    int64_t offset = args[3].ToNumber().Int64Value();
+    bool valid_width = kind == COMPARE_BYTES ? width > 0 :
+        kind == COMPARE_FLOAT ? (width == 4 || width == 8) :
+        (width == 1 || width == 2 || width == 4 || width == 8);
+    if (!valid_width || offset < 0) {
+      throw RangeError::New(env, "invalid width or offset for a comparator");
+    }
+    self->width = static_cast<size_t>(width);
+    self->offset = static_cast<size_t>(offset);
+    self->descending = args[4].ToBoolean();
+  } else if (kind == COLLECT) {
+    if (!args[5].IsArray()) {
+      throw TypeError::New(env, "sinks require the layout of their arguments");
+    }
+    Array layout = args[5].As<Array>();
+    for (uint32_t i = 0; i < layout.Length(); i++) {
+      self->layout.push_back(layout.Get(i).ToNumber().Uint32Value());
+    }
+    bool valid = self->layout.size() == static_cast<size_t>(cif->nargs) + 1 &&
+        self->layout[0] > 0;
+    for (unsigned i = 0; valid && i < cif->nargs; i++) {
+      valid = self->layout[i + 1] + cif->arg_types[i]->size <= self->layout[0];
+    }
+    if (!valid) {
+      throw RangeError::New(env, "invalid layout for the sink's arguments");
+    }
+  } else if (kind == ROUTE) {
+    if (args[5].IsTypedArray()) {
+      // shared with JS: the targets get published, and the router closed,
+      // through the BigUint64Array
+      napi_typedarray_type type;
+      size_t length = 0;
+      void* data = nullptr;
+      napi_get_typedarray_info(env, args[5], &type, &length, &data, nullptr, nullptr);
+      if (type != napi_biguint64_array || length < 3) {
+        throw TypeError::New(env, "router tables must be BigUint64Arrays of the targets, closed flag and call count");
+      }
+      self->table = static_cast<std::atomic<uint64_t>*>(data);
+      self->targetCount = length - 2;
+    } else if (args[5].IsArray() && args[5].As<Array>().Length() > 0) {
+      Array targets = args[5].As<Array>();
+      self->targetCount = targets.Length();
+      self->ownedTable.reset(new std::atomic<uint64_t>[self->targetCount + 2]);
+      self->table = self->ownedTable.get();
+      for (uint32_t i = 0; i < targets.Length(); i++) {
+        Value target = targets.Get(i);
+        void* address;
+        if (target.IsBuffer()) {
+          address = GetBufferData<void>(target);
+        } else if (target.IsBigInt()) {
+          bool lossless;
+          address = reinterpret_cast<void*>(target.As<BigInt>().Uint64Value(&lossless));
+        } else {
+          throw TypeError::New(env, "router targets must be Buffers or BigInt addresses");
+        }
+        if (address == nullptr) {
+          throw TypeError::New(env, "router targets must not be NULL");
+        }
+        self->table[i].store(reinterpret_cast<uintptr_t>(address));
+      }
+      self->table[self->targetCount].store(0);
+      self->table[self->targetCount + 1].store(0);
+    } else {
+      throw TypeError::New(env, "routers require an Array of target function pointers");
+    }
+    int32_t key = args[6].IsNumber() ? args[6].ToNumber().Int32Value() : -1;
+    if (key < -1 || key >= static_cast<int32_t>(cif->nargs)) {
+      throw RangeError::New(env, "invalid key argument index for a router");
+    }
+    self->keyIndex = key;
+  } else if (kind != COUNT) {
+    throw RangeError::New(env, "unknown native callback kind");
+  }
+
+  self->closure = static_cast<ffi_closure*>(ffi_closure_alloc(sizeof(ffi_closure), &self->code));
+  if (self->closure == nullptr) {
+    throw Error::New(env, "ffi_closure_alloc() Returned Error");
+  }
+  ffi_status status = ffi_prep_closure_loc(self->closure, cif, Invoke, self.get(), self->code);
+  if (status != FFI_OK) {
+    Error e = Error::New(env, "ffi_prep_closure() Returned Error");
+    e.Set("status", Number::New(env, status));
+    throw e;
+  }
+
+  return External<NativeCallback>::New(env, self.release(), [](Env env, NativeCallback* self) {
+    delete self;
+  });
+}
+
+/*
+ * args[0] - External - the `NativeCallback`
+ *
+ * returns the executable C function pointer as a Buffer
+ */
+
+Value NativeCallback::Pointer(const Napi::CallbackInfo& args) {
+  return WrapPointer(args.Env(), Unwrap(args)->code, sizeof(void*));
+}
+
+/*
+ * args[0] - External - the `NativeCallback`
+ *
+ * returns a copy of the tuples a sink collected so far
+ */
+
+Value NativeCallback::Contents(const Napi::CallbackInfo& args) {
+  NativeCallback* self = Unwrap(args);
+  std::lock_guard<std::mutex> lock(self->mutex);
+  return Buffer<char>::Copy(args.Env(), self->data.data(), self->data.size());
+}
+
+/*
+ * args[0] - External - the `NativeCallback`
+ *
+ * returns the number of invokations since the last reset
+ */
+
+Value NativeCallback::Count(const Napi::CallbackInfo& args) {
+  return Number::New(args.Env(), static_cast<double>(Unwrap(args)->count.load()));
+}
+
+/*
+ * args[0] - External - the `NativeCallback`
+ *
+ * Clears the collected tuples and the invokation count.
+ */
+
+void NativeCallback::Reset(const Napi::CallbackInfo& args) {
+  NativeCallback* self = Unwrap(args);
+  std::lock_guard<std::mutex> lock(self->mutex);
+  self->data.clear();
+  self->count.store(0);
+}
+
+}
@@ -0,0 +1,117 @@
+#include "ffi.h"
+
+namespace FFI {
+
+// grows past half full, which keeps the linear probe sequences short
+static const size_t kMinCapacity = 64;
+
+PointerMap::PointerMap(napi_env env)
+  : m_env(env), m_slots(kMinCapacity, Slot { nullptr, nullptr, false }), m_count(0) {}
+
+// like InstanceData's, the references can't be deleted once the env is torn
+// down, so there is no destructor deleting them
+
+inline size_t PointerMap::Home(char* ptr) const {
+  // Fibonacci hashing, the low bits of addresses are mostly alignment
+  uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)) * 0x9E3779B97F4A7C15ull;
+  return static_cast<size_t>(h >> 32) & (m_slots.size() - 1);
+}
+
+// the slot of `ptr`, or the empty slot ending its probe sequence
+inline size_t PointerMap::Find(char* ptr) const {
+  size_t mask = m_slots.size() - 1;
+  size_t i = Home(ptr);
+  while (m_slots[i].ptr != nullptr && m_slots[i].ptr != ptr) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+ArrayBuffer PointerMap::Get(char* ptr, bool* external) {
+  size_t i = Find(ptr);
+  if (m_slots[i].ptr == nullptr) {
+    return ArrayBuffer();
+  }
+  napi_value value = nullptr;
+  napi_get_reference_value(m_env, m_slots[i].ab, &value);
+  if (value == nullptr) {
+    // GC'd, and the address may belong to another allocation by now
+    EraseAt(i);
+    return ArrayBuffer();
+  }
+  if (external != nullptr) {
+    *external = m_slots[i].external;
+  }
+  return ArrayBuffer(m_env, value);
+}
+
+void PointerMap::Set(char* ptr, ArrayBuffer ab, bool external) {
+  napi_ref ref;
+  if (napi_create_reference(m_env, ab, 0, &ref) != napi_ok) {
+    throw Error::New(Env(m_env));
+  }
+  size_t i = Find(ptr);
+  if (m_slots[i].ptr != nullptr) {
+    napi_delete_reference(m_env, m_slots[i].ab);
+    m_slots[i].ab = ref;
+    m_slots[i].external = external;
+    return;
+  }
+  m_slots[i] = Slot { ptr, ref, external };
+  if (++m_count * 2 > m_slots.size()) {
+    Rehash();
+  }
+}
+
+void PointerMap::Forget(char* ptr) {
+  size_t i = Find(ptr);
+  if (m_slots[i].ptr != nullptr) {
+    EraseAt(i);
+  }
+}
+
+// backward-shift deletion: moves the rest of the probe sequence into the
+// hole, so that lookups never need tombstones
+void PointerMap::EraseAt(size_t i) {
+  napi_delete_reference(m_env, m_slots[i].ab);
+  size_t mask = m_slots.size() - 1;
+  for (size_t j = (i + 1) & mask; m_slots[j].ptr != nullptr; j = (j + 1) & mask) {
+    size_t home = Home(m_slots[j].ptr);
+    // the entry can move back to `i` unless its home lies in (i, j]
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      m_slots[i] = m_slots[j];
+      i = j;
+    }
+  }
+  m_slots[i] = Slot { nullptr, nullptr, false };
+  m_count--;
+}
+
+// drops the entries of GC'd ArrayBuffers, then resizes to at most 1/4 full,
+// shrinking the table too when most of it was dead
+void PointerMap::Rehash() {
+  std::vector<Slot> live;
+  live.reserve(m_count);
+  for (const Slot& slot : m_slots) {
+    if (slot.ptr == nullptr) continue;
+    napi_value value = nullptr;
+    napi_get_reference_value(m_env, slot.ab, &value);
+    if (value == nullptr) {
+      napi_delete_reference(m_env, slot.ab);
+    } else {
+      live.push_back(slot);
+    }
+  }
+
+  size_t capacity = kMinCapacity;
+  while (live.size() * 4 > capacity) {
+    capacity *= 2;
+  }
+  m_slots.assign(capacity, Slot { nullptr, nullptr, false });
+  m_count = live.size();
+  for (const Slot& slot : live) {
+    m_slots[Find(slot.ptr)] = slot;
+  }
+}
+
+}
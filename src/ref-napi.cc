@@ -1,7 +1,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <string>
 #include <unordered_map>
+#include <vector>
+#include <type_traits>
 
 #include "ffi.h"
 #include "ref-napi.h"
@@ -18,6 +21,26 @@
     #define __STDC_FORMAT_MACROS
   #endif
   #include <inttypes.h>
+  #include <sys/mman.h>
+#endif
+
+// the vectorized scans of reinterpretUntilZeros(): SSE2 is part of x86_64,
+// and AVX2 gets picked at runtime where the compiler can target it per function.
+// Other architectures, arm64 included, scan one element at a time
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define REF_SCAN_SSE2
+  #include <emmintrin.h>
+  #if defined(__GNUC__) || defined(__clang__)
+    #define REF_SCAN_AVX2
+    #include <immintrin.h>
+  #endif
+#endif
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  #define REF_ALWAYS_INLINE __forceinline
+#else
+  #define REF_ALWAYS_INLINE __attribute__((always_inline)) inline
 #endif
 
 
@@ -33,64 +56,28 @@ using namespace Napi;
 // we could use `node::Buffer::kMaxLength`, but it's not defined on node v0.6.x
 static const size_t kMaxLength = 0x3fffffff;
 
-enum ArrayBufferMode {
-  AB_CREATED_BY_REF,
-  AB_PASSED_TO_REF
-};
+// the largest integer a Number represents exactly, 2^53 - 1
+static const uint64_t kMaxSafeInteger = 9007199254740991ULL;
 
-// Since Node.js v14.0.0, we have to keep a global list of all ArrayBuffer
-// instances that we work with, in order not to create any duplicates.
-// Luckily, N-API instance data is available on v12.x and above.
-namespace FFI {
-
-  inline void UnregisterArrayBuffer(InstanceData *data, char* ptr) {
-    auto it = data->pointer_to_orig_buffer.find(ptr);
-    if (--it->second.finalizer_count == 0)
-      data->pointer_to_orig_buffer.erase(it);
-  }
-
-  inline void RegisterArrayBufferImpl(InstanceData *data, ArrayBuffer buf, ArrayBufferMode mode) {
-    char* ptr = static_cast<char*>(buf.Data());
-    if (ptr == nullptr) return;
-
-    auto it = data->pointer_to_orig_buffer.find(ptr);
-    if (it != data->pointer_to_orig_buffer.end()) {
-      if (!it->second.ab.Value().IsEmpty()) {
-        // Already have a valid entry, nothing to do.
-        return;
-      }
-      it->second.ab.Reset(buf, 0);
-      it->second.finalizer_count++;
-    } else {
-      data->pointer_to_orig_buffer.emplace(ptr, ArrayBufferEntry {
-        Reference<ArrayBuffer>::New(buf, 0),
-        1
-      });
-    }
-
-    // If AB_CREATED_BY_REF, then another finalizer has been added before this
-    // as a "real" backing store finalizer.
-    if (mode != AB_CREATED_BY_REF) {
-      buf.AddFinalizer([=](Env env, char* ptr) {
-        UnregisterArrayBuffer(data, ptr);
-      }, ptr);
-    }
-  }
+// transparent huge pages are 2 MiB on x86_64 and on arm64 with 4 KiB pages
+static const size_t kHugePageSize = 2 * 1024 * 1024;
 
+// Since Node.js v14.0.0, we have to keep track of all ArrayBuffer instances
+// that we work with, in order not to create any duplicates. Luckily, N-API
+// instance data is available on v12.x and above. See FFI::PointerMap.
+namespace FFI {
 
-  inline ArrayBuffer LookupOrCreateArrayBuffer(InstanceData *data, char* ptr, size_t length) {
+  inline ArrayBuffer LookupOrCreateArrayBuffer(InstanceData *data, char* ptr) {
     assert(ptr != nullptr);
-    ArrayBuffer ab;
-    auto it = data->pointer_to_orig_buffer.find(ptr);
-    if (it != data->pointer_to_orig_buffer.end())
-      ab = it->second.ab.Value();
+    ArrayBuffer ab = data->pointer_to_orig_buffer.Get(ptr);
 
+    // V8 doesn't allow two ArrayBuffers of the same memory, so the one of an
+    // address is never replaced while it is alive. It claims kMaxLength for
+    // any later view to fit in, whatever the length of the first one, and
+    // only the Buffer views get bounded to their length.
     if (ab.IsEmpty()) {
-      length = std::max<size_t>(length, kMaxLength);
-      ab = Buffer<char>::New(data->env, ptr, length, [=](Env env, char* ptr) {
-        UnregisterArrayBuffer(data, ptr);
-      }).ArrayBuffer();
-      RegisterArrayBufferImpl(data, ab, AB_CREATED_BY_REF);
+      ab = Buffer<char>::New(data->env, ptr, kMaxLength).ArrayBuffer();
+      data->pointer_to_orig_buffer.Set(ptr, ab, true);
     }
     return ab;
   }
@@ -98,8 +85,15 @@ namespace FFI {
 
 void FFI::InstanceData::RegisterArrayBuffer(napi_value val) {
     ArrayBuffer buf(env, val);
-    RegisterArrayBufferImpl(this, buf, AB_PASSED_TO_REF);
+    char* ptr = static_cast<char*>(buf.Data());
+    // an empty ArrayBuffer doesn't hold any memory to register
+    if (ptr == nullptr || buf.ByteLength() == 0) return;
+
+    // Already have a valid entry, nothing to do.
+    if (!pointer_to_orig_buffer.Get(ptr).IsEmpty()) return;
+    pointer_to_orig_buffer.Set(ptr, buf, false);
 }
+
 /**
  * Converts an arbitrary pointer to a node Buffer with specified length
  */
@@ -109,7 +103,7 @@ napi_value FFI::InstanceData::WrapPointer(char* ptr, size_t length) {
     length = 0;
 
   if (ptr != nullptr) {
-    ArrayBuffer ab = LookupOrCreateArrayBuffer(this, ptr, length);
+    ArrayBuffer ab = LookupOrCreateArrayBuffer(this, ptr);
     assert(!ab.IsEmpty());
     return this->buffer_from.Call({
       ab, Number::New(env, 0), Number::New(env, length)
@@ -138,14 +132,17 @@ char* GetBufferData(Value val) {
   return data->GetBufferData(val);
 }
 
-char* AddressForArgs(const CallbackInfo& args, size_t offset_index = 1) {
+// `escapes` - whether the address may come back through WrapPointer(), for
+// which the Buffer's ArrayBuffer needs to be registered
+char* AddressForArgs(const CallbackInfo& args, size_t offset_index = 1, bool escapes = false) {
   Value buf = args[0];
   if (!buf.IsBuffer()) {
     throw TypeError::New(args.Env(), "Buffer instance expected");
   }
 
   int64_t offset = args[offset_index].ToNumber();
-  return GetBufferData(buf) + offset;
+  char* ptr = escapes ? GetBufferData(buf) : FFI::PeekBufferData<char>(buf);
+  return ptr + offset;
 }
 
 /**
@@ -157,7 +154,9 @@ char* AddressForArgs(const CallbackInfo& args, size_t offset_index = 1) {
  */
 
 Value Address (const CallbackInfo& args) {
-  char* ptr = AddressForArgs(args);
+  // the address may be written to memory with writeAddress() and be read
+  // back as a Buffer with readPointer()
+  char* ptr = AddressForArgs(args, 1, true);
   intptr_t intptr = reinterpret_cast<intptr_t>(ptr);
 
   return BigInt::New(args.Env(), (int64_t)intptr);
@@ -230,11 +229,63 @@ Value ReadPointer(const CallbackInfo& args) {
   }
 
   int64_t size = args[2].ToNumber();
+  if (size < 0) {
+    throw RangeError::New(env, "readPointer: invalid length");
+  }
 
   char* val = *reinterpret_cast<char**>(ptr);
   return WrapPointer(env, val, size);
 }
 
+// wraps the `count` pointers of `table` into Buffers of `size` bytes, NULL
+// ones as `null`
+Value PointerArrayToValue(Env env, char** table, int64_t count, int64_t size) {
+  if (count < 0 || count > UINT32_MAX) {
+    throw RangeError::New(env, "readPointerArray: invalid count");
+  }
+  if (size < 0) {
+    throw RangeError::New(env, "readPointerArray: invalid length");
+  }
+  Array result = Array::New(env, static_cast<size_t>(count));
+  for (uint32_t i = 0; i < count; i++) {
+    if (table[i] == nullptr) {
+      result.Set(i, env.Null());
+    } else {
+      result.Set(i, WrapPointer(env, table[i], size));
+    }
+  }
+  return result;
+}
+
+/**
+ * Reads `count` consecutive memory addresses, like a table of function
+ * pointers, in one go. NULL entries are returned as `null`.
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - Number - the number of pointers to read
+ * args[3] - Number - the length in bytes of the returned Buffer instances
+ */
+
+Value ReadPointerArray(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readPointerArray: Cannot read from nullptr pointer");
+  }
+
+  int64_t offset = args[1].ToNumber();
+  int64_t count = args[2].ToNumber();
+  // the whole table has to lie within the Buffer it is read from
+  size_t length = args[0].As<Buffer<char>>().Length();
+  if (count >= 0 && (offset < 0 || static_cast<uint64_t>(offset) > length ||
+      static_cast<uint64_t>(count) * sizeof(char*) > length - offset)) {
+    throw RangeError::New(env, "readPointerArray: reading past the end of the Buffer");
+  }
+  return PointerArrayToValue(env, reinterpret_cast<char**>(ptr), count, args[3].ToNumber());
+}
+
 /**
  * Writes the memory address of the "input" buffer (and optional offset) to the
  * specified "buf" buffer and offset. Essentially making "buf" hold a reference
@@ -285,23 +336,183 @@ void WritePointer(const CallbackInfo& args) {
 
 Value ReinterpretBuffer(const CallbackInfo& args) {
   Env env = args.Env();
-  char* ptr = AddressForArgs(args, 2);
+  char* ptr = AddressForArgs(args, 2, true);
 
   if (ptr == nullptr) {
     throw Error::New(env, "reinterpret: Cannot reinterpret from nullptr pointer");
   }
 
   int64_t size = args[1].ToNumber();
+  if (size < 0) {
+    throw RangeError::New(env, "reinterpret: invalid length");
+  }
 
   return WrapPointer(env, ptr, size);
 }
 
+inline unsigned CountTrailingZeros(uint64_t v) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanForward64(&index, v);
+  return index;
+#elif defined(_MSC_VER)
+  unsigned index = 0;
+  while (!(v & 1)) {
+    v >>= 1;
+    index++;
+  }
+  return index;
+#else
+  return __builtin_ctzll(v);
+#endif
+}
+
+/*
+ * Scanning for the first zero element of type T, see ScanUntilZeros().
+ */
+
+template <typename T>
+size_t ScanScalar(const char* ptr, size_t max) {
+  size_t size = 0;
+  for (; size < max; size += sizeof(T)) {
+    T value;
+    memcpy(&value, ptr + size, sizeof(T));
+    if (value == 0) {
+      break;
+    }
+  }
+  return size;
+}
+
+/*
+ * Scans `Blocks::kWidth` bytes at a time, with aligned loads. An aligned
+ * block never straddles two pages, so reading the whole block containing
+ * `ptr`, or the one containing the zero element, can't fault where reading
+ * element by element wouldn't, even though it reads past either end. The
+ * `Blocks` policies return a mask of the bytes of zero elements in a block,
+ * `kBitsPerByte` bits per byte.
+ */
+
+// forced inline, for ZeroMask() to get inlined into ScanAVX2()'s AVX2 code
+template <typename T, typename Blocks>
+REF_ALWAYS_INLINE size_t ScanBlocks(const char* ptr, size_t max) {
+  const char* block = reinterpret_cast<const char*>(
+      reinterpret_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(Blocks::kWidth - 1));
+  // drops the bytes of the first block before `ptr`
+  uint64_t mask = Blocks::template ZeroMask<T>(block) >> ((ptr - block) * Blocks::kBitsPerByte);
+  size_t base = 0;  // bytes from `ptr` to the first one `mask` covers
+  for (;;) {
+    if (mask != 0) {
+      size_t size = base + CountTrailingZeros(mask) / Blocks::kBitsPerByte;
+      return size < max ? size : max;
+    }
+    block += Blocks::kWidth;
+    base = block - ptr;
+    if (base >= max) {
+      return max;
+    }
+    mask = Blocks::template ZeroMask<T>(block);
+  }
+}
+
+#if defined(REF_SCAN_SSE2)
+template <size_t N> inline __m128i EqualsZero128(__m128i v);
+template <> inline __m128i EqualsZero128<2>(__m128i v) {
+  return _mm_cmpeq_epi16(v, _mm_setzero_si128());
+}
+template <> inline __m128i EqualsZero128<4>(__m128i v) {
+  return _mm_cmpeq_epi32(v, _mm_setzero_si128());
+}
+template <> inline __m128i EqualsZero128<8>(__m128i v) {
+  // no 64-bit compare before SSE4.1: both 32-bit halves must be zero
+  __m128i eq = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+  return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+struct SSE2Blocks {
+  static const size_t kWidth = 16;
+  static const unsigned kBitsPerByte = 1;
+
+  template <typename T>
+  static inline uint64_t ZeroMask(const char* block) {
+    __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    return static_cast<uint32_t>(_mm_movemask_epi8(EqualsZero128<sizeof(T)>(v)));
+  }
+};
+#endif
+
+#if defined(REF_SCAN_AVX2)
+struct AVX2Blocks {
+  static const size_t kWidth = 32;
+  static const unsigned kBitsPerByte = 1;
+
+  template <typename T>
+  __attribute__((target("avx2")))
+  static inline uint64_t ZeroMask(const char* block) {
+    __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i zero = _mm256_setzero_si256();
+    __m256i eq = sizeof(T) == 2 ? _mm256_cmpeq_epi16(v, zero)
+               : sizeof(T) == 4 ? _mm256_cmpeq_epi32(v, zero)
+               : _mm256_cmpeq_epi64(v, zero);
+    return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+  }
+};
+
+template <typename T>
+__attribute__((target("avx2")))
+size_t ScanAVX2(const char* ptr, size_t max) {
+  return ScanBlocks<T, AVX2Blocks>(ptr, max);
+}
+
+bool HasAVX2() {
+  static const bool has = __builtin_cpu_supports("avx2");
+  return has;
+}
+#endif
+
+/*
+ * Returns the size in bytes of the elements of type T at `ptr` before the
+ * first zero one, at most `max` bytes.
+ */
+
+template <typename T>
+size_t ScanUntilZeros(const char* ptr, size_t max) {
+  max -= max % sizeof(T);
+  if (reinterpret_cast<uintptr_t>(ptr) % sizeof(T) != 0) {
+    // the elements would straddle the lanes of the aligned blocks
+    return ScanScalar<T>(ptr, max);
+  }
+#if defined(REF_SCAN_AVX2)
+  if (HasAVX2()) {
+    return ScanAVX2<T>(ptr, max);
+  }
+#endif
+#if defined(REF_SCAN_SSE2)
+  return ScanBlocks<T, SSE2Blocks>(ptr, max);
+#else
+  return ScanScalar<T>(ptr, max);
+#endif
+}
+
+// the optional maximum length in bytes of reinterpretUntilZeros() at args[2]
+size_t MaxLengthForArgs(const CallbackInfo& args, size_t unbounded) {
+  if (args.Length() < 3 || args[2].IsUndefined()) {
+    return unbounded;
+  }
+  int64_t max = args[2].ToNumber();
+  if (max < 0) {
+    throw RangeError::New(args.Env(), "reinterpretUntilZeros: invalid maximum length");
+  }
+  return static_cast<size_t>(max);
+}
+
 /**
  * Same as `ref.reinterpretUntilZeros()`, except that this version does not attach _buffer_ to the
  * returned Buffer, which is potentially unsafe if the garbage collector runs.
  *
  * args[0] - Buffer - the "buf" Buffer instance to read the address from
  * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - Number - optional - the maximum length in bytes to scan
  * return A new Buffer instance with the same memory address as _buffer_, and a variable `length` that
  *  is terminated by sizeof(T) NUL bytes.
  */
@@ -309,36 +520,759 @@ Value ReinterpretBuffer(const CallbackInfo& args) {
 template<typename T>
 Value ReinterpretBufferUntilZeros(const CallbackInfo& args) {
   Env env = args.Env();
-  char* ptr = AddressForArgs(args);
+  char* ptr = AddressForArgs(args, 1, true);
 
   if (ptr == nullptr) {
     throw Error::New(env, "reinterpretUntilZeros: Cannot reinterpret from nullptr pointer");
   }
-  size_t size = 0;
-  while (size < kMaxLength) {
-    if ((*(T*)(ptr + size))== 0) {
-      break;
-    }
-    size += sizeof(T);
-  }
+  size_t size = ScanUntilZeros<T>(ptr, MaxLengthForArgs(args, kMaxLength));
 
   return WrapPointer(env, ptr, size);
 }
 
 Value _reinterpretUntilZeros8(const CallbackInfo& args) {
   Env env = args.Env();
-  char* ptr = AddressForArgs(args);
+  char* ptr = AddressForArgs(args, 1, true);
 
   if (ptr == nullptr) {
     throw Error::New(env, "reinterpretUntilZeros: Cannot reinterpret from nullptr pointer");
   }
-  return WrapPointer(env, ptr, strlen(ptr));
+  // libc's strlen() is vectorized already
+  if (args.Length() < 3 || args[2].IsUndefined()) {
+    return WrapPointer(env, ptr, strlen(ptr));
+  }
+  return WrapPointer(env, ptr, strnlen(ptr, MaxLengthForArgs(args, 0)));
 }
 
 auto _reinterpretUntilZeros16 = ReinterpretBufferUntilZeros<uint16_t>;
 auto _reinterpretUntilZeros32 = ReinterpretBufferUntilZeros<uint32_t>;
 auto _reinterpretUntilZeros64 = ReinterpretBufferUntilZeros<uint64_t>;
 
+/**
+ * Returns the given address as a Number, or as a BigInt when it's past
+ * `Number.MAX_SAFE_INTEGER`, as tagged pointers are.
+ */
+
+Value AddressToValue(Env env, char* ptr) {
+  uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr));
+  if (address <= kMaxSafeInteger) {
+    return Number::New(env, static_cast<double>(address));
+  }
+  return BigInt::New(env, address);
+}
+
+/**
+ * Returns the address given as a Number, a BigInt or a Buffer, with `null`
+ * and `undefined` as NULL.
+ *
+ * `escapes` - whether the address of a Buffer may come back through
+ * WrapPointer(), see AddressForArgs()
+ */
+
+char* AddressFromValue(Env env, Value val, bool escapes) {
+  if (val.IsNumber()) {
+    double address = val.As<Number>().DoubleValue();
+    if (!(address >= 0) || address > static_cast<double>(kMaxSafeInteger) ||
+        address != static_cast<double>(static_cast<uint64_t>(address))) {
+      throw RangeError::New(env, "invalid address");
+    }
+    return reinterpret_cast<char*>(static_cast<uintptr_t>(address));
+  }
+  if (val.IsBigInt()) {
+    bool lossless;
+    uint64_t address = val.As<BigInt>().Uint64Value(&lossless);
+    if (!lossless || address > static_cast<uint64_t>(UINTPTR_MAX)) {
+      throw RangeError::New(env, "invalid address");
+    }
+    return reinterpret_cast<char*>(static_cast<uintptr_t>(address));
+  }
+  if (val.IsBuffer()) {
+    return escapes ? GetBufferData(val) : FFI::PeekBufferData<char>(val);
+  }
+  if (val.IsNull() || val.IsUndefined()) {
+    return nullptr;
+  }
+  throw TypeError::New(env, "address Number, BigInt or Buffer instance expected");
+}
+
+/**
+ * Whether the given Buffer or address is NULL, without allocating a BigInt
+ * like comparing `address()` does.
+ *
+ * args[0] - Buffer|Number|BigInt - the pointer to check
+ */
+
+Value IsNull(const CallbackInfo& args) {
+  return Boolean::New(args.Env(), AddressFromValue(args.Env(), args[0], false) == nullptr);
+}
+
+/**
+ * Reads the pointer at the given Buffer and offset as an address, a Number
+ * (or a BigInt, see AddressToValue()) rather than a Buffer instance.
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ */
+
+Value ReadAddress(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readAddress: Cannot read from nullptr pointer");
+  }
+  return AddressToValue(env, *reinterpret_cast<char**>(ptr));
+}
+
+/**
+ * Writes the given address to the given Buffer and offset.
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to write to
+ * args[1] - Number|BigInt|Buffer - the address to write, `null` for NULL
+ * args[2] - Number - the offset from the "buf" buffer's address to write to
+ */
+
+void WriteAddress(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args, 2);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "writeAddress: Cannot write to nullptr pointer");
+  }
+  *reinterpret_cast<char**>(ptr) = AddressFromValue(env, args[1], true);
+}
+
+/*
+ * The `read*At()` / `write*At()` accessors take the memory as an address,
+ * args[0], so that handles can be dereferenced without wrapping them in a
+ * Buffer first. Reads take the offset from it as args[1], writes take the
+ * value as args[1] and the offset as args[2]. They go through memcpy(), as
+ * nothing tells that the address is aligned.
+ */
+
+char* AddressAtForArgs(const CallbackInfo& args, size_t offset_index) {
+  char* ptr = AddressFromValue(args.Env(), args[0], false);
+  if (ptr == nullptr) {
+    throw Error::New(args.Env(), "Cannot access memory at the NULL address");
+  }
+  int64_t offset = args[offset_index].ToNumber();
+  return ptr + offset;
+}
+
+template <typename T>
+Value ReadNumberAt(const CallbackInfo& args) {
+  T value;
+  memcpy(&value, AddressAtForArgs(args, 1), sizeof(T));
+  return Number::New(args.Env(), static_cast<double>(value));
+}
+
+template <typename T>
+void WriteNumberAt(const CallbackInfo& args) {
+  char* ptr = AddressAtForArgs(args, 2);
+  Number input = args[1].ToNumber();
+  T value;
+  if (std::is_floating_point<T>::value) {
+    value = static_cast<T>(input.DoubleValue());
+  } else {
+    // wraps around like the typed arrays do
+    value = static_cast<T>(input.Int64Value());
+  }
+  memcpy(ptr, &value, sizeof(T));
+}
+
+template <typename T>
+Value ReadBigIntAt(const CallbackInfo& args) {
+  T value;
+  memcpy(&value, AddressAtForArgs(args, 1), sizeof(T));
+  return BigInt::New(args.Env(), value);
+}
+
+template <typename T>
+void WriteBigIntAt(const CallbackInfo& args) {
+  char* ptr = AddressAtForArgs(args, 2);
+  Value input = args[1];
+  T value;
+  if (input.IsBigInt()) {
+    bool lossless;
+    value = std::is_signed<T>::value
+      ? static_cast<T>(input.As<BigInt>().Int64Value(&lossless))
+      : static_cast<T>(input.As<BigInt>().Uint64Value(&lossless));
+  } else {
+    value = static_cast<T>(input.ToNumber().Int64Value());
+  }
+  memcpy(ptr, &value, sizeof(T));
+}
+
+Value ReadPointerAt(const CallbackInfo& args) {
+  char* value;
+  memcpy(&value, AddressAtForArgs(args, 1), sizeof(char*));
+  return AddressToValue(args.Env(), value);
+}
+
+// readPointerArray() at an address, like a table of function pointers that
+// no Buffer covers
+Value ReadPointerArrayAt(const CallbackInfo& args) {
+  char** table = reinterpret_cast<char**>(AddressAtForArgs(args, 1));
+  return PointerArrayToValue(args.Env(), table, args[2].ToNumber(), args[3].ToNumber());
+}
+
+void WritePointerAt(const CallbackInfo& args) {
+  char* ptr = AddressAtForArgs(args, 2);
+  char* value = AddressFromValue(args.Env(), args[1], true);
+  memcpy(ptr, &value, sizeof(char*));
+}
+
+Value ReadCStringAt(const CallbackInfo& args) {
+  return String::New(args.Env(), AddressAtForArgs(args, 1));
+}
+
+/*
+ * Decodes a C string straight into a JS String, as UTF-8 or as Latin-1,
+ * without creating a Buffer for it first.
+ */
+
+Value CStringToValue(Env env, const char* ptr, bool latin1) {
+  napi_value result;
+  napi_status status = latin1
+    ? napi_create_string_latin1(env, ptr, NAPI_AUTO_LENGTH, &result)
+    : napi_create_string_utf8(env, ptr, NAPI_AUTO_LENGTH, &result);
+  if (status != napi_ok) {
+    throw Error::New(env);
+  }
+  return Value(env, result);
+}
+
+// frees a C string decoded by CStringToValue(), which the caller owns
+void FreeCString(Env env, char* ptr) {
+  FFI::InstanceData* data = FFI::InstanceData::Get(env);
+  bool external = false;
+  ArrayBuffer ab = data->pointer_to_orig_buffer.Get(ptr, &external);
+  if (!ab.IsEmpty()) {
+    if (!external) {
+      // allocated by JS or by allocNative(), not by malloc()
+      throw Error::New(env, "Cannot free() the memory of a Buffer that malloc() did not allocate");
+    }
+    // the Buffers still wrapping it would read freed memory otherwise
+#if NAPI_VERSION > 6
+    ab.Detach();
+#else
+    throw Error::New(env, "Cannot free() the memory of a Buffer without detaching it");
+#endif
+    // and must not be found for the next allocation
+    data->pointer_to_orig_buffer.Forget(ptr);
+  }
+  free(ptr);
+}
+
+/**
+ * Returns the C string at the given Buffer and offset as a JS String.
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - Boolean - whether to decode it as Latin-1 instead of UTF-8
+ */
+
+Value ReadCString(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readCString: Cannot read from nullptr pointer");
+  }
+  return CStringToValue(env, ptr, args[2].ToBoolean());
+}
+
+/**
+ * Reads the `char *` at the given Buffer and offset, and returns the C string
+ * it points to as a JS String, or `null` for NULL. The `CString` types' get().
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read the pointer from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - Boolean - whether to free() the C string once decoded, and set
+ *                     the pointer to NULL
+ */
+
+Value ReadCStringPointer(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readCString: Cannot read from nullptr pointer");
+  }
+  char* string = *reinterpret_cast<char**>(ptr);
+  if (string == nullptr) {
+    return env.Null();
+  }
+  Value result = CStringToValue(env, string, false);
+  if (args[2].ToBoolean()) {
+    FreeCString(env, string);
+    // so that reading it again, like a struct field, can't free it twice
+    *reinterpret_cast<char**>(ptr) = nullptr;
+  }
+  return result;
+}
+
+/**
+ * Returns the C string at the given pointer as a JS String, and free()s it.
+ * Returns `null` for NULL.
+ *
+ * args[0] - Buffer|Number|BigInt - the pointer to the C string
+ * args[1] - Boolean - whether to decode it as Latin-1 instead of UTF-8
+ */
+
+Value ReadCStringAndFree(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressFromValue(env, args[0], false);
+
+  if (ptr == nullptr) {
+    return env.Null();
+  }
+  Value result = CStringToValue(env, ptr, args[1].ToBoolean());
+  FreeCString(env, ptr);
+  return result;
+}
+
+/*
+ * The read cache of an interned `CString` type: a direct-mapped table of the
+ * JS Strings last decoded for each address. A hit still compares the bytes
+ * at the address with the ones the String was decoded from, so that a
+ * string changed in place, or freed and reallocated, gets decoded again.
+ */
+
+class CStringCache {
+  public:
+    CStringCache(napi_env env, size_t size) : m_env(env), m_entries(size) {}
+
+    ~CStringCache() {
+      for (Entry& entry : m_entries) {
+        if (entry.value != nullptr) {
+          napi_delete_reference(m_env, entry.value);
+        }
+      }
+    }
+
+    Value Get(Env env, const char* ptr) {
+      Entry& entry = m_entries[Index(ptr)];
+      if (entry.ptr == ptr && strcmp(ptr, entry.bytes.c_str()) == 0) {
+        napi_value value;
+        napi_get_reference_value(env, entry.value, &value);
+        return Value(env, value);
+      }
+
+      Value result = CStringToValue(env, ptr, false);
+      napi_ref ref;
+      if (napi_create_reference(env, result, 1, &ref) != napi_ok) {
+        throw Error::New(env);
+      }
+      if (entry.value != nullptr) {
+        napi_delete_reference(env, entry.value);
+      }
+      entry.ptr = ptr;
+      entry.bytes.assign(ptr);
+      entry.value = ref;
+      return result;
+    }
+
+  private:
+    struct Entry {
+      const char* ptr = nullptr;
+      std::string bytes;
+      napi_ref value = nullptr;
+    };
+
+    size_t Index(const char* ptr) const {
+      // Fibonacci hashing, like PointerMap: the low bits are mostly alignment
+      uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)) * 0x9E3779B97F4A7C15ull;
+      return static_cast<size_t>(h >> 32) & (m_entries.size() - 1);
+    }
+
+    napi_env m_env;
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * Creates the read cache of an interned `CString` type.
+ *
+ * args[0] - Number - the number of cached strings, a power of two
+ *
+ * returns an External wrapping a new `CStringCache`
+ */
+
+Value CreateCStringCache(const CallbackInfo& args) {
+  Env env = args.Env();
+  int64_t size = args[0].ToNumber();
+
+  if (size <= 0 || (size & (size - 1)) != 0) {
+    throw RangeError::New(env, "the cache size must be a power of two");
+  }
+  CStringCache* cache = new CStringCache(env, static_cast<size_t>(size));
+  return External<CStringCache>::New(env, cache, [](Env env, CStringCache* cache) {
+    delete cache;
+  });
+}
+
+/**
+ * Same as `_readCStringPointer()` without freeing, returning the cached JS
+ * String while the C string at the address is unchanged. The interned
+ * `CString` types' get().
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read the pointer from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - External - the `CStringCache`
+ */
+
+Value ReadCStringInterned(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readCString: Cannot read from nullptr pointer");
+  }
+  if (!args[2].IsExternal()) {
+    throw TypeError::New(env, "readCString: CStringCache External expected");
+  }
+  char* string = *reinterpret_cast<char**>(ptr);
+  if (string == nullptr) {
+    return env.Null();
+  }
+  return args[2].As<External<CStringCache>>().Data()->Get(env, string);
+}
+
+/*
+ * Wide C strings: UTF-16 ones (`U16String`), UTF-32 ones (`U32String`), and
+ * the `wchar_t` ones (`WString`) that are either of the two, in the native
+ * byte order.
+ */
+
+// wide strings at least this many UTF-16 code units long get created as
+// external strings, which V8 keeps pointing at instead of copying into its heap
+static const size_t kExternalStringMinLength = 4096;
+
+// node_api_create_external_string_utf16() gets looked up at runtime: it is
+// only declared for NAPI_VERSION 10 or NAPI_EXPERIMENTAL, and only Node.js
+// v18.18.0, v20.4.0 and later export it
+typedef napi_status (*CreateExternalStringUTF16)(napi_env env, char16_t* str,
+    size_t length, napi_finalize finalize_callback, void* finalize_hint,
+    napi_value* result, bool* copied);
+
+CreateExternalStringUTF16 GetCreateExternalStringUTF16() {
+  static const CreateExternalStringUTF16 create = reinterpret_cast<CreateExternalStringUTF16>(
+      dlsym(dlopen(nullptr, RTLD_LAZY), "node_api_create_external_string_utf16"));
+  return create;
+}
+
+void FreeExternalString(napi_env env, void* data, void* hint) {
+  free(data);
+}
+
+// creates a JS String from the `length` UTF-16 code units of the malloc()'d
+// `units`, and takes ownership of them
+Value OwnedUTF16ToValue(Env env, char16_t* units, size_t length) {
+  napi_value result;
+  CreateExternalStringUTF16 create = GetCreateExternalStringUTF16();
+  if (create != nullptr && length >= kExternalStringMinLength) {
+    // when V8 copies them anyway, the finalizer has already freed them
+    bool copied;
+    if (create(env, units, length, FreeExternalString, nullptr, &result, &copied) == napi_ok) {
+      return Value(env, result);
+    }
+  }
+  napi_status status = napi_create_string_utf16(env, units, length, &result);
+  free(units);
+  if (status != napi_ok) {
+    throw Error::New(env);
+  }
+  return Value(env, result);
+}
+
+Value UTF16ToValue(Env env, const char* ptr, size_t length) {
+  if (GetCreateExternalStringUTF16() != nullptr && length >= kExternalStringMinLength) {
+    // the C string may be changed or freed, an external string needs a copy
+    char16_t* copy = static_cast<char16_t*>(malloc(length * sizeof(char16_t)));
+    if (copy != nullptr) {
+      memcpy(copy, ptr, length * sizeof(char16_t));
+      return OwnedUTF16ToValue(env, copy, length);
+    }
+  }
+  napi_value result;
+  if (napi_create_string_utf16(env, reinterpret_cast<const char16_t*>(ptr), length, &result) != napi_ok) {
+    throw Error::New(env);
+  }
+  return Value(env, result);
+}
+
+// invalid code points and lone surrogates decode as U+FFFD
+Value UTF32ToValue(Env env, const char* ptr, size_t length) {
+  // at most a surrogate pair per code point
+  char16_t* units = static_cast<char16_t*>(malloc((length * 2 + 1) * sizeof(char16_t)));
+  if (units == nullptr) {
+    throw Error::New(env, "readWString: out of memory");
+  }
+  size_t n = 0;
+  for (size_t i = 0; i < length; i++) {
+    uint32_t c;
+    memcpy(&c, ptr + i * sizeof(uint32_t), sizeof(uint32_t));
+    if (c >= 0x10000 && c <= 0x10FFFF) {
+      c -= 0x10000;
+      units[n++] = static_cast<char16_t>(0xD800 + (c >> 10));
+      units[n++] = static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+    } else if (c < 0xD800 || (c > 0xDFFF && c < 0x10000)) {
+      units[n++] = static_cast<char16_t>(c);
+    } else {
+      units[n++] = 0xFFFD;
+    }
+  }
+  return OwnedUTF16ToValue(env, units, n);
+}
+
+// the wide C string at `ptr`, of `unit_size` bytes per code unit
+Value WideStringToValue(Env env, const char* ptr, int64_t unit_size) {
+  if (unit_size == 2) {
+    return UTF16ToValue(env, ptr, ScanUntilZeros<uint16_t>(ptr, kMaxLength) / 2);
+  }
+  if (unit_size == 4) {
+    return UTF32ToValue(env, ptr, ScanUntilZeros<uint32_t>(ptr, kMaxLength) / 4);
+  }
+  throw RangeError::New(env, "wide strings are UTF-16 or UTF-32, of 2 or 4 bytes per code unit");
+}
+
+/**
+ * Reads the wide string pointer at the given Buffer and offset, and returns
+ * the string it points to as a JS String, or `null` for NULL. The `WString`,
+ * `U16String` and `U32String` types' get().
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to read the pointer from
+ * args[1] - Number - the offset from the "buf" buffer's address to read from
+ * args[2] - Number - the size of the code units, 2 for UTF-16 or 4 for UTF-32
+ */
+
+Value ReadWStringPointer(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args);
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "readWString: Cannot read from nullptr pointer");
+  }
+  char* string = *reinterpret_cast<char**>(ptr);
+  if (string == nullptr) {
+    return env.Null();
+  }
+  return WideStringToValue(env, string, args[2].ToNumber());
+}
+
+/**
+ * Returns a new Buffer with the given String encoded as a NUL-terminated
+ * wide string, for the `WString`, `U16String` and `U32String` types' set().
+ * Lone surrogates get encoded as U+FFFD in UTF-32.
+ *
+ * args[0] - String - the string to encode
+ * args[1] - Number - the size of the code units, 2 for UTF-16 or 4 for UTF-32
+ */
+
+Value EncodeWString(const CallbackInfo& args) {
+  Env env = args.Env();
+  int64_t unit_size = args[1].ToNumber();
+
+  if (!args[0].IsString()) {
+    throw TypeError::New(env, "writeWString: String expected");
+  }
+  size_t length = 0;
+  napi_get_value_string_utf16(env, args[0], nullptr, 0, &length);
+
+  if (unit_size == 2) {
+    Buffer<char> buf = Buffer<char>::New(env, (length + 1) * sizeof(char16_t));
+    // NUL terminated by napi_get_value_string_utf16()
+    napi_get_value_string_utf16(env, args[0], reinterpret_cast<char16_t*>(buf.Data()),
+                                length + 1, &length);
+    return buf;
+  }
+  if (unit_size != 4) {
+    throw RangeError::New(env, "wide strings are UTF-16 or UTF-32, of 2 or 4 bytes per code unit");
+  }
+
+  std::u16string units = args[0].As<String>().Utf16Value();
+  size_t count = units.size();
+  for (size_t i = 0; i + 1 < units.size(); i++) {
+    if (units[i] >= 0xD800 && units[i] <= 0xDBFF && units[i + 1] >= 0xDC00 && units[i + 1] <= 0xDFFF) {
+      count--;  // a surrogate pair
+      i++;
+    }
+  }
+  Buffer<char> buf = Buffer<char>::New(env, (count + 1) * sizeof(uint32_t));
+  char* out = buf.Data();
+  for (size_t i = 0; i < units.size(); i++, out += sizeof(uint32_t)) {
+    uint32_t c = units[i];
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < units.size() &&
+        units[i + 1] >= 0xDC00 && units[i + 1] <= 0xDFFF) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (units[++i] - 0xDC00);
+    } else if (c >= 0xD800 && c <= 0xDFFF) {
+      c = 0xFFFD;
+    }
+    memcpy(out, &c, sizeof(uint32_t));
+  }
+  memset(out, 0, sizeof(uint32_t));
+  return buf;
+}
+
+/**
+ * Writes a malloc()'d UTF-8 copy of the given String to the given Buffer and
+ * offset, for C code that takes ownership of the strings it gets, and frees
+ * them. The `OwnedCString` type's set().
+ *
+ * args[0] - Buffer - the "buf" Buffer instance to write the pointer to
+ * args[1] - String - the string to copy, `null` for NULL
+ * args[2] - Number - the offset from the "buf" buffer's address to write to
+ */
+
+void WriteCStringCopy(const CallbackInfo& args) {
+  Env env = args.Env();
+  char* ptr = AddressForArgs(args, 2);
+  Value input = args[1];
+
+  if (ptr == nullptr) {
+    throw Error::New(env, "writeCString: Cannot write to nullptr pointer");
+  }
+  if (input.IsNull() || input.IsUndefined()) {
+    *reinterpret_cast<char**>(ptr) = nullptr;
+    return;
+  }
+  if (!input.IsString()) {
+    throw TypeError::New(env, "writeCString: String expected");
+  }
+
+  size_t length = 0;
+  napi_get_value_string_utf8(env, input, nullptr, 0, &length);
+  char* copy = static_cast<char*>(malloc(length + 1));
+  if (copy == nullptr) {
+    throw Error::New(env, "writeCString: out of memory");
+  }
+  napi_get_value_string_utf8(env, input, copy, length + 1, &length);
+  *reinterpret_cast<char**>(ptr) = copy;
+}
+
+void FreeAligned(char* ptr) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+/**
+ * Allocates native memory that the returned Buffer doesn't own: it gets
+ * freed by `ref.free()`, or when the Buffer gets GC'd otherwise. The size
+ * is reported to V8 as external memory, for the GC to account for it.
+ *
+ * args[0] - Number - the size in bytes of the allocation
+ * args[1] - Number - the alignment of its address, a power of two
+ * args[2] - Boolean - whether to advise the kernel to back it with huge pages
+ * args[3] - Boolean - whether to zero-fill the memory
+ */
+
+Value AllocNative(const CallbackInfo& args) {
+  Env env = args.Env();
+  int64_t size = args[0].ToNumber();
+  int64_t alignment = args[1].ToNumber();
+  bool hugePages = args[2].ToBoolean();
+  bool zero = args[3].ToBoolean();
+
+  if (size < 0 || static_cast<uint64_t>(size) > SIZE_MAX / 2) {
+    throw RangeError::New(env, "allocNative: invalid size");
+  }
+  if (alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+    throw RangeError::New(env, "allocNative: the alignment must be a power of two");
+  }
+
+  size_t align = std::max<size_t>(alignment, sizeof(void*));
+  size_t allocated = std::max<size_t>(size, 1);
+#ifdef MADV_HUGEPAGE
+  if (hugePages) {
+    // whole huge pages only, or the kernel can't use them at the ends
+    align = std::max(align, kHugePageSize);
+    allocated = (allocated + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  }
+#endif
+
+  char* ptr = nullptr;
+#ifdef _WIN32
+  ptr = static_cast<char*>(_aligned_malloc(allocated, align));
+#else
+  if (posix_memalign(reinterpret_cast<void**>(&ptr), align, allocated) != 0) {
+    ptr = nullptr;
+  }
+#endif
+  if (ptr == nullptr) {
+    throw Error::New(env, "allocNative: out of memory");
+  }
+#ifdef MADV_HUGEPAGE
+  if (hugePages) {
+    // only a hint, the memory is usable either way
+    madvise(ptr, allocated, MADV_HUGEPAGE);
+  }
+#endif
+  if (zero) {
+    // after madvise(), so that the pages get faulted in as huge pages
+    memset(ptr, 0, allocated);
+  }
+
+  FFI::InstanceData* data = FFI::InstanceData::Get(env);
+  FFI::NativeAllocation* allocation = new FFI::NativeAllocation { ptr, allocated, false };
+  Buffer<char> buf = Buffer<char>::New(env, ptr, size,
+      [=](Env env, char* ptr, FFI::NativeAllocation* allocation) {
+    if (!allocation->freed) {
+      data->native_allocations.erase(ptr);
+      FreeAligned(ptr);
+      MemoryManagement::AdjustExternalMemory(env, -static_cast<int64_t>(allocation->size));
+    }
+    delete allocation;
+  }, allocation);
+  // replaces any Buffer still wrapping memory freed by C at this address
+  data->pointer_to_orig_buffer.Set(ptr, buf.ArrayBuffer(), false);
+  data->native_allocations[ptr] = allocation;
+  MemoryManagement::AdjustExternalMemory(env, static_cast<int64_t>(allocated));
+  return buf;
+}
+
+/**
+ * Frees the memory of a Buffer returned by `ref.allocNative()` right away.
+ * The Buffer gets detached, so it (and any view of it) reads as empty
+ * instead of pointing at the freed memory.
+ *
+ * args[0] - Buffer - the Buffer instance returned by `allocNative()`
+ */
+
+void FreeNative(const CallbackInfo& args) {
+  Env env = args.Env();
+  if (!args[0].IsBuffer()) {
+    throw TypeError::New(env, "free: Buffer instance expected");
+  }
+  Buffer<char> buf = args[0].As<Buffer<char>>();
+  FFI::InstanceData* data = FFI::InstanceData::Get(env);
+
+  auto it = data->native_allocations.find(buf.Data());
+  if (it == data->native_allocations.end()) {
+    throw Error::New(env, "free: Buffer was not returned by allocNative(), or was already freed");
+  }
+  FFI::NativeAllocation* allocation = it->second;
+
+  // a Buffer still wrapping the freed memory would be a use-after-free, so
+  // the memory is only freed once the Buffer has been detached
+#if NAPI_VERSION > 6
+  buf.ArrayBuffer().Detach();
+#else
+  throw Error::New(env, "free: detaching Buffers requires N-API version 7");
+#endif
+  data->native_allocations.erase(it);
+
+  // the address may get reused by the next allocation, which must not find
+  // this Buffer's ArrayBuffer in the registry
+  data->pointer_to_orig_buffer.Forget(allocation->ptr);
+
+  allocation->freed = true;
+  FreeAligned(allocation->ptr);
+  MemoryManagement::AdjustExternalMemory(env, -static_cast<int64_t>(allocation->size));
+}
+
 } // anonymous namespace
 
 Object Init(Env env, Object exports) {
@@ -372,6 +1306,7 @@ Object Init(Env env, Object exports) {
   SET_SIZEOF(ulonglong, unsigned long long);
   SET_SIZEOF(pointer, char *);
   SET_SIZEOF(size_t, size_t);
+  SET_SIZEOF(wchar_t, wchar_t);
   // size of a weak handle to a JS object
   SET_SIZEOF(Object, Reference<Object>);
 
@@ -404,6 +1339,7 @@ Object Init(Env env, Object exports) {
   SET_ALIGNOF(ulonglong, unsigned long long);
   SET_ALIGNOF(pointer, char *);
   SET_ALIGNOF(size_t, size_t);
+  SET_ALIGNOF(wchar_t, wchar_t);
   SET_ALIGNOF(Object, Reference<Object>);
 
   // exports
@@ -414,11 +1350,42 @@ Object Init(Env env, Object exports) {
   exports["readObject"] = Function::New(env, ReadObject);
   exports["_writeObject"] = Function::New(env, WriteObject);
   exports["readPointer"] = Function::New(env, ReadPointer);
+  exports["readPointerArray"] = Function::New(env, ReadPointerArray);
   exports["_writePointer"] = Function::New(env, WritePointer);
   exports["_reinterpret"] = Function::New(env, ReinterpretBuffer);
   exports["_reinterpretUntilZeros8"] = Function::New(env, _reinterpretUntilZeros8);
   exports["_reinterpretUntilZeros16"] = Function::New(env, _reinterpretUntilZeros16);
   exports["_reinterpretUntilZeros32"] = Function::New(env, _reinterpretUntilZeros32);
   exports["_reinterpretUntilZeros64"] = Function::New(env, _reinterpretUntilZeros64);
+  exports["_isNull"] = Function::New(env, IsNull);
+  exports["readAddress"] = Function::New(env, ReadAddress);
+  exports["writeAddress"] = Function::New(env, WriteAddress);
+#define SET_ACCESSORS_AT(name, read, write) \
+  exports[ "read" #name "At" ] = Function::New(env, read); \
+  exports[ "write" #name "At" ] = Function::New(env, write);
+  SET_ACCESSORS_AT(Int8, ReadNumberAt<int8_t>, WriteNumberAt<int8_t>);
+  SET_ACCESSORS_AT(UInt8, ReadNumberAt<uint8_t>, WriteNumberAt<uint8_t>);
+  SET_ACCESSORS_AT(Int16, ReadNumberAt<int16_t>, WriteNumberAt<int16_t>);
+  SET_ACCESSORS_AT(UInt16, ReadNumberAt<uint16_t>, WriteNumberAt<uint16_t>);
+  SET_ACCESSORS_AT(Int32, ReadNumberAt<int32_t>, WriteNumberAt<int32_t>);
+  SET_ACCESSORS_AT(UInt32, ReadNumberAt<uint32_t>, WriteNumberAt<uint32_t>);
+  SET_ACCESSORS_AT(Int64, ReadBigIntAt<int64_t>, WriteBigIntAt<int64_t>);
+  SET_ACCESSORS_AT(UInt64, ReadBigIntAt<uint64_t>, WriteBigIntAt<uint64_t>);
+  SET_ACCESSORS_AT(Float, ReadNumberAt<float>, WriteNumberAt<float>);
+  SET_ACCESSORS_AT(Double, ReadNumberAt<double>, WriteNumberAt<double>);
+  SET_ACCESSORS_AT(Pointer, ReadPointerAt, WritePointerAt);
+  exports["readPointerArrayAt"] = Function::New(env, ReadPointerArrayAt);
+  exports["readCStringAt"] = Function::New(env, ReadCStringAt);
+  exports["_readCString"] = Function::New(env, ReadCString);
+  exports["_readCStringPointer"] = Function::New(env, ReadCStringPointer);
+  exports["_readCStringAndFree"] = Function::New(env, ReadCStringAndFree);
+  exports["_createCStringCache"] = Function::New(env, CreateCStringCache);
+  exports["_readCStringInterned"] = Function::New(env, ReadCStringInterned);
+  exports["_readWStringPointer"] = Function::New(env, ReadWStringPointer);
+  exports["_encodeWString"] = Function::New(env, EncodeWString);
+  exports["_hasExternalStrings"] = Boolean::New(env, GetCreateExternalStringUTF16() != nullptr);
+  exports["_writeCStringCopy"] = Function::New(env, WriteCStringCopy);
+  exports["_allocNative"] = Function::New(env, AllocNative);
+  exports["free"] = Function::New(env, FreeNative);
   return exports;
 }
@@ -1,31 +1,120 @@
+#include <cstddef>
+#include <cstring>
 #include "ffi.h"
 
 namespace FFI {
 
-ThreadedCallbackInvokation::ThreadedCallbackInvokation(callback_info* cbinfo, void* retval, void** parameters) {
+static inline void CpuRelax() {
+#ifdef WIN32
+  YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+ThreadedCallbackInvokation::ThreadedCallbackInvokation()
+  : m_kind(BLOCKING), m_retval(nullptr), m_parameters(nullptr),
+    m_cbinfo(nullptr), m_next(nullptr), m_state(DONE) {
+  uv_sem_init(&m_sem, 0);
+}
+
+ThreadedCallbackInvokation::ThreadedCallbackInvokation(callback_info* cbinfo, ffi_cif* cif, void** parameters)
+  : m_kind(parameters == nullptr ? OVERFLOW : NON_BLOCKING), m_retval(nullptr),
+    m_parameters(nullptr), m_cbinfo(cbinfo), m_next(nullptr), m_state(PENDING) {
+  if (m_kind == OVERFLOW) {
+    return;
+  }
+
+  // one block holding the `void**` array, a scratch return value and then
+  // each argument, every part aligned like `new char[]` itself is
+  const size_t align = alignof(std::max_align_t);
+  auto aligned = [align](size_t n) { return (n + align - 1) & ~(align - 1); };
+
+  size_t total = aligned(sizeof(void*) * cif->nargs) + aligned(sizeof(ffi_arg));
+  for (unsigned i = 0; i < cif->nargs; i++) {
+    total += aligned(cif->arg_types[i]->size);
+  }
+  m_storage.reset(new char[total]);
+
+  char* cursor = m_storage.get();
+  m_parameters = reinterpret_cast<void**>(cursor);
+  cursor += aligned(sizeof(void*) * cif->nargs);
+  m_retval = cursor;
+  cursor += aligned(sizeof(ffi_arg));
+  for (unsigned i = 0; i < cif->nargs; i++) {
+    size_t size = cif->arg_types[i]->size;
+    memcpy(cursor, parameters[i], size);
+    m_parameters[i] = cursor;
+    cursor += aligned(size);
+  }
+}
+
+ThreadedCallbackInvokation::~ThreadedCallbackInvokation() {
+  if (m_kind == BLOCKING) {
+    uv_sem_destroy(&m_sem);
+  }
+}
+
+ThreadedCallbackInvokation* ThreadedCallbackInvokation::ForCurrentThread() {
+  static thread_local ThreadedCallbackInvokation inv;
+  return &inv;
+}
+
+void ThreadedCallbackInvokation::Prepare(callback_info* cbinfo, void* retval, void** parameters) {
   m_cbinfo = cbinfo;
   m_retval = retval;
   m_parameters = parameters;
+  m_next = nullptr;
+  // published to the JS thread by the release in InvokationQueue::Push()
+  m_state.store(PENDING, std::memory_order_relaxed);
+}
 
-  uv_mutex_init(&m_mutex);
-  uv_mutex_lock(&m_mutex);
-  uv_cond_init(&m_cond);
+void ThreadedCallbackInvokation::SignalDoneExecuting() {
+  // the owning thread may return (and reuse this object) as soon as it sees
+  // DONE, so don't touch anything but the semaphore it's sleeping on
+  if (m_state.exchange(DONE, std::memory_order_acq_rel) == SLEEPING) {
+    uv_sem_post(&m_sem);
+  }
 }
 
-ThreadedCallbackInvokation::~ThreadedCallbackInvokation() {
-  uv_mutex_unlock(&m_mutex);
-  uv_cond_destroy(&m_cond);
-  uv_mutex_destroy(&m_mutex);
+void ThreadedCallbackInvokation::WaitForExecution(uint32_t spin_count) {
+  for (uint32_t i = 0; i < spin_count; i++) {
+    if (m_state.load(std::memory_order_acquire) == DONE) {
+      return;
+    }
+    CpuRelax();
+  }
+
+  uint32_t expected = PENDING;
+  if (m_state.compare_exchange_strong(expected, SLEEPING, std::memory_order_acq_rel)) {
+    uv_sem_wait(&m_sem);
+  }
 }
 
-void ThreadedCallbackInvokation::SignalDoneExecuting() {
-  uv_mutex_lock(&m_mutex);
-  uv_cond_signal(&m_cond);
-  uv_mutex_unlock(&m_mutex);
+bool InvokationQueue::Push(ThreadedCallbackInvokation* inv) {
+  ThreadedCallbackInvokation* head = m_head.load(std::memory_order_relaxed);
+  do {
+    inv->m_next = head;
+  } while (!m_head.compare_exchange_weak(head, inv,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  return head == nullptr;
 }
 
-void ThreadedCallbackInvokation::WaitForExecution() {
-  uv_cond_wait(&m_cond, &m_mutex);
+ThreadedCallbackInvokation* InvokationQueue::TakeAll() {
+  ThreadedCallbackInvokation* head = m_head.exchange(nullptr, std::memory_order_acquire);
+
+  // the stack is newest first, reverse it into call order
+  ThreadedCallbackInvokation* fifo = nullptr;
+  while (head != nullptr) {
+    ThreadedCallbackInvokation* next = head->m_next;
+    head->m_next = fifo;
+    fifo = head;
+    head = next;
+  }
+  return fifo;
 }
 
 }
@@ -1,5 +1,6 @@
 'use strict';
 const assert = require('assert');
+const path = require('path');
 const ffi = require('../');
 const { ref, types } = ffi
 const bindings = require('node-gyp-build')(__dirname);
@@ -156,6 +157,137 @@ describe('Callback', function () {
     }
   });
 
+  describe('native marshalling', function () {
+    it('should pass scalar arguments and return values of every size', function () {
+      [
+        [ 'int8', -128, 127 ],
+        [ 'uint8', 0, 255 ],
+        [ 'int16', -32768, 32767 ],
+        [ 'uint16', 0, 65535 ],
+        [ 'int32', -2147483648, 2147483647 ],
+        [ 'uint32', 0, 4294967295 ],
+        [ 'int64', -(2n ** 63n), 2n ** 63n - 1n ],
+        [ 'uint64', 0n, 2n ** 64n - 1n ],
+        [ 'double', -1.5, Number.MAX_VALUE ],
+        [ 'float', -1.5, 0.25 ]
+      ].forEach(function ([ type, min, max ]) {
+        const cb = ffi.Callback(type, [ type, type ], function (a, b) {
+          assert.strictEqual(typeof a, typeof min);
+          return a === min ? b : a;
+        });
+        const fn = ffi.ForeignFunction(cb, type, [ type, type ]);
+        assert.strictEqual(fn(min, max), max, type);
+        assert.strictEqual(fn(max, min), max, type);
+      });
+    });
+
+    it('should pass "bool" arguments as booleans', function () {
+      const cb = ffi.Callback('bool', [ 'bool' ], function (b) {
+        assert.strictEqual(typeof b, 'boolean');
+        return !b;
+      });
+      const fn = ffi.ForeignFunction(cb, 'bool', [ 'bool' ]);
+      assert.strictEqual(fn(true), false);
+      assert.strictEqual(fn(false), true);
+    });
+
+    it('should pass pointer arguments as Buffers of the deref\'d type', function () {
+      const intPtr = ref.refType(types.int);
+      const cb = ffi.Callback(intPtr, [ intPtr ], function (ptr) {
+        assert.strictEqual(ptr.length, types.int.size);
+        assert.strictEqual(ptr.type.indirection, 1);
+        assert.strictEqual(ref.deref(ptr), 42);
+        return ptr;
+      });
+      const fn = ffi.ForeignFunction(cb, intPtr, [ intPtr ]);
+      const buf = ref.alloc(types.int, 42);
+      assert.strictEqual(ref.address(fn(buf)), ref.address(buf));
+    });
+
+    it('should require a BigInt for 64-bit return values', function () {
+      const cb = ffi.Callback('int64', [ ], function () {
+        return 1;
+      });
+      const fn = ffi.ForeignFunction(cb, 'int64', [ ]);
+      assert.throws(function () {
+        fn();
+      }, /error setting return value/);
+    });
+
+    it('should keep using "get()" and "set()" of the other types', function () {
+      const cb = ffi.Callback('char', [ 'char' ], function (c) {
+        assert.strictEqual(c, 'a');
+        return 'b';
+      });
+      const fn = ffi.ForeignFunction(cb, 'char', [ 'char' ]);
+      assert.strictEqual(fn('a'), 'b');
+    });
+  });
+
+  describe('top-level and nested invokations', function () {
+    it('should call back with a microtask checkpoint from the event loop', function (done) {
+      const order = [];
+      const cb = ffi.Callback('void', [ ], function () {
+        order.push('callback');
+        Promise.resolve().then(() => order.push('microtask'));
+        setImmediate(function () {
+          order.push('immediate');
+          assert.deepStrictEqual([ 'callback', 'microtask', 'immediate' ], order);
+          cb.free();
+          done();
+        });
+      });
+      bindings.set_cb(cb);
+      bindings.call_cb_from_loop();
+    });
+
+    it('should call back in the calling context from within an ffi_call', function () {
+      const asyncHooks = require('async_hooks');
+      const outer = asyncHooks.executionAsyncId();
+      const ids = [];
+      const libc = ffi.Library(process.platform == 'win32' ? 'msvcrt' : null, {
+        qsort: [ 'void', [ 'pointer', 'size_t', 'size_t', 'pointer' ] ]
+      });
+      const cmp = ffi.Callback('int', [ 'pointer', 'pointer' ], function (a, b) {
+        ids.push(asyncHooks.executionAsyncId());
+        return ffi.ref.readInt32At(a, 0) - ffi.ref.readInt32At(b, 0);
+      });
+      const values = Buffer.from(new Int32Array([ 3, 1, 2 ]).buffer);
+      libc.qsort(values, 3n, 4n, cmp);
+      assert.deepStrictEqual([ 1, 2, 3 ], Array.from(new Int32Array(values.buffer, values.byteOffset, 3)));
+      assert(ids.length > 0);
+      ids.forEach(id => assert.strictEqual(outer, id));
+      cmp.free();
+    });
+  });
+
+  describe('free()', function () {
+    it('should reuse the closure of a freed callback of the same signature', function () {
+      const a = ffi.Callback('int', [ 'int' ], Math.abs);
+      const address = ref.address(a);
+      a.free();
+      const b = ffi.Callback('int', [ 'int' ], function (x) { return x * 2; });
+      assert.strictEqual(address, ref.address(b));
+      assert.strictEqual(8, ffi.ForeignFunction(b, 'int', [ 'int' ])(4));
+    });
+
+    it('should prepare closures reused across signatures again', function () {
+      ffi.Callback('int', [ 'int' ], Math.abs).free();
+      const b = ffi.Callback('double', [ 'double', 'double' ], Math.max);
+      assert.strictEqual(2.5, ffi.ForeignFunction(b, 'double', [ 'double', 'double' ])(1, 2.5));
+    });
+
+    it('should not release a reused closure when the freed Buffer gets GC\'d', function () {
+      let a = ffi.Callback('int', [ 'int' ], Math.abs);
+      a.free();
+      a.free(); // no-op
+      const b = ffi.Callback('int', [ 'int' ], function (x) { return x + 1; });
+      a = null;
+      global.gc();
+      assert.strictEqual(5, ffi.ForeignFunction(b, 'int', [ 'int' ])(4));
+    });
+  });
+
   describe('async', function () {
     it('should be invokable asynchronously by an ffi\'d ForeignFunction', function (done) {
       const funcPtr = ffi.Callback(types.int, [ types.int ], Math.abs);
@@ -167,6 +299,220 @@ describe('Callback', function () {
       });
     });
 
+    it('should dispatch every invocation from many concurrent threads', function (done) {
+      const total = 64;
+      let invokeCount = 0;
+      const cb = ffi.Callback('void', [ ], function () {
+        if (++invokeCount === total) {
+          // keep the closure alive until every thread is done with it
+          cb.length;
+          setImmediate(done);
+        }
+      });
+      bindings.set_cb(cb);
+      for (let i = 0; i < total / 2; i++) {
+        bindings.call_cb_async();
+        bindings.call_cb_from_thread();
+      }
+    });
+
+    it('should dispatch invocations from other threads with a spin phase', function (done) {
+      const total = 16;
+      let invokeCount = 0;
+      ffi.Callback.setSpinCount(10000);
+      const cb = ffi.Callback('void', [ ], function () {
+        if (++invokeCount === total) {
+          ffi.Callback.setSpinCount(0);
+          cb.length;
+          setImmediate(done);
+        }
+      });
+      bindings.set_cb(cb);
+      for (let i = 0; i < total; i++) {
+        bindings.call_cb_async();
+      }
+    });
+
+    it('should throw for a negative spin count', function () {
+      assert.throws(function () {
+        ffi.Callback.setSpinCount(-1);
+      }, /spin count/);
+    });
+
+    describe('nonBlocking', function () {
+      const notify = ffi.ForeignFunction(bindings.notify_from_thread, 'void', [ 'pointer', 'int' ]);
+
+      it('should only accept "void" return types', function () {
+        assert.throws(function () {
+          ffi.Callback('int', [ ], function () {}, { nonBlocking: true });
+        }, /must return "void"/);
+      });
+
+      it('should not block the calling thread, and copy the arguments', function (done) {
+        // a blocking callback would deadlock here: the JS thread waits for
+        // the native thread to finish
+        const received = [];
+        const cb = ffi.Callback('void', [ 'int', 'double' ], function (i, d) {
+          received.push([ i, d ]);
+          if (received.length === 100) {
+            for (let j = 0; j < 100; j++) {
+              assert.deepStrictEqual([ j, j * 0.5 ], received[j]);
+            }
+            setImmediate(done);
+          }
+        }, { nonBlocking: true, queueSize: 100 });
+        notify(cb, 100);
+        assert.strictEqual(0, received.length);
+      });
+
+      it('should deliver all queued invocations with a single call with `batch`', function (done) {
+        const calls = [];
+        const cb = ffi.Callback('void', [ 'int', 'double' ], function (tuples) {
+          calls.push(tuples);
+        }, { batch: true, queueSize: 100 });
+        notify(cb, 100);
+        setImmediate(function () {
+          cb.length;
+          assert.strictEqual(1, calls.length);
+          assert.strictEqual(100, calls[0].length);
+          for (let j = 0; j < 100; j++) {
+            assert.deepStrictEqual([ j, j * 0.5 ], calls[0][j]);
+          }
+          done();
+        });
+      });
+
+      it('should wrap invocations from the JS thread in a batch of one', function () {
+        const calls = [];
+        const cb = ffi.Callback('void', [ 'int', 'double' ], function (tuples) {
+          calls.push(tuples);
+        }, { batch: true });
+        ffi.ForeignFunction(cb, 'void', [ 'int', 'double' ])(7, 1.5);
+        assert.deepStrictEqual([ [ [ 7, 1.5 ] ] ], calls);
+      });
+
+      it('should drop invocations once the queue is full with `onFull: "drop"`', function (done) {
+        let invokeCount = 0;
+        const cb = ffi.Callback('void', [ 'int', 'double' ], function () {
+          invokeCount++;
+        }, { nonBlocking: true, queueSize: 10, onFull: 'drop' });
+        notify(cb, 100);
+        setTimeout(function () {
+          cb.length;
+          assert.strictEqual(10, invokeCount);
+          done();
+        }, 50);
+      });
+
+      it('should report dropped invocations with `onFull: "error"`', function (done) {
+        let invokeCount = 0;
+        const cb = ffi.Callback('void', [ 'int', 'double' ], function () {
+          invokeCount++;
+        }, { nonBlocking: true, queueSize: 10, onFull: 'error' });
+
+        // hijack the "uncaughtException" event for this test
+        const listeners = process.listeners('uncaughtException').slice();
+        process.removeAllListeners('uncaughtException');
+        process.once('uncaughtException', function (e) {
+          listeners.forEach(function (fn) {
+            process.on('uncaughtException', fn);
+          });
+          let err;
+          try {
+            cb.length;
+            assert.strictEqual(10, invokeCount);
+            assert(/dropped 90 invocation/.test(e.message));
+          } catch (ae) {
+            err = ae;
+          }
+          done(err);
+        });
+
+        notify(cb, 100);
+      });
+    });
+
+    it('should route invocations to the worker thread that created the callback', function (done) {
+      this.timeout(10000);
+      const { Worker } = require('worker_threads');
+      const worker = new Worker(`
+        const { parentPort } = require('worker_threads');
+        const ffi = require(${JSON.stringify(path.join(__dirname, '..'))});
+        const bindings = require('node-gyp-build')(${JSON.stringify(__dirname)});
+        const notify = ffi.ForeignFunction(bindings.notify_from_thread, 'void', [ 'pointer', 'int' ]);
+
+        // invoked from a native thread, while this worker waits for it
+        const received = [];
+        const nonBlocking = ffi.Callback('void', [ 'int', 'double' ], function (i) {
+          received.push(i);
+          if (received.length === 10) {
+            parentPort.postMessage(received);
+          }
+        }, { nonBlocking: true });
+        notify(nonBlocking, 10);
+
+        // invoked from the thread pool, which waits for this worker
+        const blocking = ffi.Callback('void', [ ], function () {
+          parentPort.postMessage('blocking');
+        });
+        bindings.set_cb(blocking);
+        bindings.call_cb_async();
+        setTimeout(() => [ nonBlocking, blocking ], 5000);
+      `, { eval: true });
+
+      const messages = [];
+      worker.on('message', function (msg) {
+        messages.push(msg);
+        if (messages.length === 2) {
+          assert.deepStrictEqual([ [ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 ], 'blocking' ], messages);
+          worker.terminate().then(() => done(), done);
+        }
+      });
+      worker.once('error', done);
+    });
+
+    it('should spread invocations over a pool of workers', async function () {
+      this.timeout(10000);
+      const pooled = ffi.Callback('int', [ 'int' ],
+        path.join(__dirname, 'callback_pool_handler.js'), { workers: 2 });
+      const fn = ffi.ForeignFunction(pooled, 'int', [ 'int' ]);
+      await pooled.ready;
+
+      const threads = new Set();
+      for (let i = 0; i < 4; i++) {
+        const result = fn(i);
+        assert.strictEqual(result % 1000, i);
+        threads.add(Math.floor(result / 1000));
+      }
+      assert.strictEqual(threads.size, 2);
+      assert(!threads.has(0), 'should not run on the main thread');
+
+      await pooled.close();
+      assert.strictEqual(fn(1), 0);
+    });
+
+    it('should send invocations with the same key to the same worker', async function () {
+      this.timeout(10000);
+      const pooled = ffi.Callback('int', [ 'int' ],
+        path.join(__dirname, 'callback_pool_handler.js'), { workers: 3, key: 0 });
+      const fn = ffi.ForeignFunction(pooled, 'int', [ 'int' ]);
+      await pooled.ready;
+      const first = fn(7);
+      for (let i = 0; i < 5; i++) {
+        assert.strictEqual(fn(7), first);
+      }
+      return pooled.close();
+    });
+
+    it('should reject `ready` and close the pool when a worker fails', async function () {
+      this.timeout(10000);
+      const pooled = ffi.Callback('int', [ 'int' ],
+        path.join(__dirname, 'no_such_module.js'), { workers: 2 });
+      await assert.rejects(pooled.ready, /could not create the pooled callback/);
+      const fn = ffi.ForeignFunction(pooled, 'int', [ 'int' ]);
+      assert.strictEqual(fn(1), 0);
+    });
+
     /**
      * See https://github.com/node-ffi/node-ffi/issues/153.
      */
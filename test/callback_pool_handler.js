@@ -0,0 +1,7 @@
+'use strict';
+// the function of the pooled callbacks in callback.js, loaded by each worker
+const { threadId } = require('worker_threads');
+
+module.exports = function (i) {
+  return threadId * 1000 + i;
+};
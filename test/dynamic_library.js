@@ -3,6 +3,7 @@ const assert = require('assert');
 const path = require('path');
 const ffi = require('../');
 const fs = require('fs-extra');
+const ref = ffi.ref;
 const DynamicLibrary = ffi.DynamicLibrary;
 
 describe('DynamicLibrary', function () {
@@ -51,4 +52,43 @@ describe('DynamicLibrary', function () {
       assert.strictEqual(name, symbol.name);
     });
   });
+
+  describe('open()', function () {
+    it('should resolve to a "DynamicLibrary" instance', function () {
+      const lib = process.platform == 'win32' ? 'msvcrt' : 'libc';
+      return DynamicLibrary.open(lib + ffi.LIB_EXT).then(function (handle) {
+        assert(handle instanceof DynamicLibrary);
+        assert.strictEqual(lib + ffi.LIB_EXT, handle.path());
+      });
+    });
+
+    it('should pre-resolve the given symbols', function () {
+      const lib = process.platform == 'win32' ? 'msvcrt' : 'libc';
+      const sync = DynamicLibrary(lib + ffi.LIB_EXT);
+      return DynamicLibrary.open(lib + ffi.LIB_EXT, null, [ 'free', 'malloc' ]).then(function (handle) {
+        assert.strictEqual(2, handle._symbols.size);
+        const symbol = handle.get('free');
+        assert.strictEqual('free', symbol.name);
+        assert.strictEqual(0, symbol.length);
+        assert.strictEqual(ref.address(sync.get('free')), ref.address(symbol));
+      });
+    });
+
+    it('should throw from get() for symbols that could not be resolved', function () {
+      const lib = process.platform == 'win32' ? 'msvcrt' : 'libc';
+      return DynamicLibrary.open(lib + ffi.LIB_EXT, null, [ 'doesnotexist__' ]).then(function (handle) {
+        assert.throws(function () {
+          handle.get('doesnotexist__');
+        }, /Dynamic Symbol Retrieval Error/);
+      });
+    });
+
+    it('should reject for a library that does not exist', function () {
+      return DynamicLibrary.open('doesnotexist__' + ffi.LIB_EXT).then(function () {
+        assert(false); // unreachable
+      }, function (err) {
+        assert(/Dynamic Linking Error/.test(err.message));
+      });
+    });
+  });
 });
@@ -1,8 +1,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
 #include <napi.h>
 #include <uv.h>
+#if defined(__GLIBC__)
+  #include <malloc.h>
+#endif
 
 using namespace Napi;
 
@@ -224,6 +228,101 @@ void CallCbAsync(const CallbackInfo& args) {
                 });
 }
 
+// invokes the callback from a libuv timer on the JS thread, with no JS on the stack
+void CallCbFromLoop(const CallbackInfo& args) {
+  if (callback == nullptr)
+    throw Error::New(args.Env(), "you must call \"set_cb()\" first");
+
+  uv_timer_t* timer = new uv_timer_t;
+  uv_loop_t* loop = nullptr;
+  napi_get_uv_event_loop(args.Env(), &loop);
+  uv_timer_init(loop, timer);
+  uv_timer_start(timer, [](uv_timer_t* timer) {
+    callback();
+    uv_close(reinterpret_cast<uv_handle_t*>(timer), [](uv_handle_t* handle) {
+      delete reinterpret_cast<uv_timer_t*>(handle);
+    });
+  }, 0, 0);
+}
+
+
+// Invokes `fn` `count` times from a new thread, and waits for that thread
+typedef void (*notify_cb)(int, double);
+
+struct notify_args {
+  notify_cb fn;
+  int count;
+};
+
+void notify_from_thread(notify_cb fn, int count) {
+  notify_args a = { fn, count };
+  uv_thread_t tid;
+  uv_thread_create(&tid, [](void* data) {
+    notify_args* a = static_cast<notify_args*>(data);
+    for (int i = 0; i < a->count; i++)
+      a->fn(i, i * 0.5);
+  }, &a);
+  uv_thread_join(&tid);
+}
+
+
+// A COM-style object: a pointer to a table of functions taking the object
+struct counter_object;
+
+struct counter_vtable {
+  int (*add)(counter_object* self, int n);
+  int (*get)(counter_object* self);
+  void (*reserved)(counter_object* self);
+};
+
+struct counter_object {
+  const counter_vtable* vtbl;
+  int value;
+};
+
+int counter_add(counter_object* self, int n) {
+  return self->value += n;
+}
+
+int counter_get(counter_object* self) {
+  return self->value;
+}
+
+static const counter_vtable counter_vtbl = { counter_add, counter_get, nullptr };
+
+counter_object* counter_new(int value) {
+  return new counter_object { &counter_vtbl, value };
+}
+
+void counter_free(counter_object* self) {
+  delete self;
+}
+
+
+// A slow call failing with the given errno
+int fail_slowly(int ms, int error) {
+  uv_sleep(ms);
+  errno = error;
+  return -1;
+}
+
+// A string for the caller to free(), of `length` times 'x'
+char* large_string(int length) {
+  char* s = static_cast<char*>(malloc(length + 1));
+  memset(s, 'x', length);
+  s[length] = '\0';
+  return s;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+// The bytes that malloc() has mmap()'d. Allocations larger than the largest
+// mmap threshold (32 MiB) always are, and get unmapped by free() right away,
+// which makes this a counter of their frees.
+size_t malloc_mmapped_bytes() {
+  return mallinfo2().hblkhd;
+}
+#endif
+
 
 // Race condition in threaded callback invocation testing
 // https://github.com/node-ffi/node-ffi/issues/153
@@ -686,6 +785,7 @@ Object Initialize(Env env, Object exports) {
   exports["call_cb"] = Function::New(env, CallCb);
   exports["call_cb_from_thread"] = Function::New(env, CallCbFromThread);
   exports["call_cb_async"] = Function::New(env, CallCbAsync);
+  exports["call_cb_from_loop"] = Function::New(env, CallCbFromLoop);
 
   // also need to test these custom functions
   exports["double_box"] = WrapPointer(env, double_box);
@@ -698,6 +798,14 @@ Object Initialize(Env env, Object exports) {
   exports["array_in_struct"] = WrapPointer(env, array_in_struct);
   exports["callback_func"] = WrapPointer(env, callback_func);
   exports["play_ping_pong"] = WrapPointer(env, play_ping_pong);
+  exports["notify_from_thread"] = WrapPointer(env, notify_from_thread);
+  exports["counter_new"] = WrapPointer(env, counter_new);
+  exports["counter_free"] = WrapPointer(env, counter_free);
+  exports["large_string"] = WrapPointer(env, large_string);
+  exports["fail_slowly"] = WrapPointer(env, fail_slowly);
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  exports["malloc_mmapped_bytes"] = WrapPointer(env, malloc_mmapped_bytes);
+#endif
   exports["test_169"] = WrapPointer(env, test_169);
   exports["test_ref_56"] = WrapPointer(env, test_ref_56);
 
@@ -226,6 +226,47 @@ describe('ForeignFunction', function () {
     })
   });
 
+  describe('promise', function () {
+    it('should resolve with the return value from the thread pool', function () {
+      const abs = ffi.ForeignFunction(bindings.abs, 'int', [ 'int' ]);
+      return abs.promise(-1234).then(function (res) {
+        assert.strictEqual(1234, res);
+      });
+    });
+
+    it('should reject when setting an argument throws', function () {
+      const abs = ffi.ForeignFunction(bindings.abs, 'int', [ 'int' ]);
+      return abs.promise(1111111111111111111111).then(function () {
+        assert(false); // unreachable
+      }, function (err) {
+        assert(/error setting argument/.test(err.message));
+      });
+    });
+
+    it('should stay synchronous until an `adaptive` function is observed slow', function () {
+      const fast = ffi.ForeignFunction(bindings.abs, 'int', [ 'int' ], undefined, {
+        adaptive: { threshold: 1000, minSamples: 1 }
+      });
+      assert.strictEqual(5, fast(-5));
+      assert.strictEqual(false, fast.stats().offloaded);
+      assert.strictEqual(1, fast.stats().execTime.count);
+
+      const slow = ffi.ForeignFunction(bindings.abs, 'int', [ 'int' ], undefined, {
+        adaptive: { threshold: 0, minSamples: 2 }
+      });
+      assert.strictEqual(5, slow(-5));
+      assert.strictEqual(false, slow.stats().offloaded);
+      assert.strictEqual(5, slow(-5));
+      assert.strictEqual(true, slow.stats().offloaded);
+
+      return Promise.all([ fast.promise(-6), slow.promise(-7) ]).then(function (res) {
+        assert.deepStrictEqual([ 6, 7 ], res);
+        assert.strictEqual(2, fast.stats().execTime.count);
+        assert.strictEqual(3, slow.stats().execTime.count);
+      });
+    });
+  });
+
   it('check uv version', function() {
     const uv_func = ffi.Library(null, {
       uv_version_string: [ffi.types.CString, []],
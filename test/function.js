@@ -39,4 +39,60 @@ describe('Function "type"', function () {
     assert.strictEqual(Math.abs(-69), abs(-69));
     assert.strictEqual(Math.abs(3), abs(3));
   });
+
+  it('should reuse the callback of a JS function written more than once', function () {
+    if (typeof WeakRef !== 'function') {
+      return this.skip();
+    }
+    const fn = ffi.Function('int', [ 'int' ]);
+    const a = ref.alloc(fn, Math.abs);
+    const b = ref.alloc(fn, Math.abs);
+    assert.strictEqual(ref.address(ref.readPointer(a)), ref.address(ref.readPointer(b)));
+
+    // another function type of the same signature shares it too
+    const c = ref.alloc(ffi.Function('int', [ 'int' ]), Math.abs);
+    assert.strictEqual(ref.address(ref.readPointer(a)), ref.address(ref.readPointer(c)));
+
+    const d = ref.alloc(fn, Math.sign);
+    assert.notStrictEqual(ref.address(ref.readPointer(a)), ref.address(ref.readPointer(d)));
+    assert.strictEqual(-1, fn.get(d, 0)(-7));
+  });
+
+  it('should reuse the ForeignFunction of a function pointer read more than once', function () {
+    const fn = ffi.Function('int', [ 'int' ]);
+    const vtable = ref.alloc(fn, Math.abs);
+    const abs = fn.get(vtable, 0);
+    assert.strictEqual(abs, fn.get(vtable, 0));
+    assert.strictEqual(abs, fn.toFunction(ref.readPointer(vtable)));
+    assert.strictEqual(5, abs(-5));
+  });
+
+  it('should not keep the Callback of a function pointer read alive', function () {
+    if (typeof WeakRef !== 'function' || typeof FinalizationRegistry !== 'function') {
+      return this.skip();
+    }
+    const fn = ffi.Function('int', [ 'int' ]);
+    let collected = false;
+    const registry = new FinalizationRegistry(() => { collected = true; });
+    (function () {
+      const callback = ffi.Callback('int', [ 'int' ], x => x);
+      registry.register(callback, null);
+      const vtable = ref.alloc('pointer');
+      ref.writePointer(vtable, callback);
+      assert.strictEqual(3, fn.get(vtable, 0)(3));
+    })();
+    return new Promise(function poll (resolve) {
+      global.gc();
+      if (collected) {
+        resolve();
+      } else {
+        setTimeout(poll, 10, resolve);
+      }
+    });
+  });
+
+  it('should validate the function pointer', function () {
+    const fn = ffi.Function('int', [ 'int' ]);
+    assert.throws(() => fn.toFunction(1234), /expected Buffer/);
+  });
 });
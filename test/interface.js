@@ -0,0 +1,104 @@
+'use strict';
+const assert = require('assert');
+const ffi = require('../');
+const { ref } = ffi
+const bindings = require('node-gyp-build')(__dirname);
+
+describe('Interface', function () {
+  afterEach(global.gc);
+
+  const counterNew = ffi.ForeignFunction(bindings.counter_new, 'pointer', [ 'int' ]);
+  const counterFree = ffi.ForeignFunction(bindings.counter_free, 'void', [ 'pointer' ]);
+  const counters = [];
+  afterEach(function () {
+    counters.splice(0).forEach(function (counter) {
+      counterFree(counter);
+    });
+  });
+
+  function newCounter (value) {
+    const counter = counterNew(value);
+    counters.push(counter);
+    return counter;
+  }
+
+  const Counter = ffi.Interface({
+    add: [ 'int', [ 'int' ] ],
+    get: [ 'int', [ ] ],
+    reserved: [ 'void', [ ] ]
+  });
+
+  it('should bind the function table of an instance', function () {
+    const counter = Counter(newCounter(5));
+    assert.strictEqual(typeof counter.add, 'function');
+    assert.strictEqual(8, counter.add(3));
+    assert.strictEqual(8, counter.get());
+  });
+
+  it('should keep the instances apart', function () {
+    const a = Counter(newCounter(1));
+    const b = Counter(newCounter(100));
+    a.add(1);
+    assert.strictEqual(2, a.get());
+    assert.strictEqual(100, b.get());
+  });
+
+  it('should return null for NULL entries of the table', function () {
+    assert.strictEqual(null, Counter(newCounter(0)).reserved);
+  });
+
+  it('should pre-bind the instance to the async and promise variants', async function () {
+    const counter = Counter(newCounter(5));
+    assert.strictEqual(7, await counter.add.promise(2));
+    await new Promise(function (resolve, reject) {
+      counter.get.async(function (err, value) {
+        if (err) return reject(err);
+        assert.strictEqual(7, value);
+        resolve();
+      });
+    });
+  });
+
+  it('should bind a longer layout after a shorter one of the same instance', function () {
+    const Base = ffi.Interface({ add: [ 'int', [ 'int' ] ] });
+    const instance = newCounter(1);
+    const base = Base(instance);
+    const counter = Counter(instance);
+    assert.strictEqual(3, base.add(2));
+    assert.strictEqual(3, counter.get());
+    assert.strictEqual(null, counter.reserved);
+  });
+
+  it('should bind a table without a receiver argument', function () {
+    // the table of a plain struct of function pointers, with `abs()` in it
+    const table = Buffer.alloc(ref.sizeof.pointer);
+    ref.writePointer(table, bindings.abs, 0);
+    const Abs = ffi.Interface({ abs: [ 'int', [ 'int' ] ] }, { indirect: false, receiver: false });
+    assert.strictEqual(3, Abs(table).abs(-3));
+  });
+
+  it('should read a table of pointers with a single call', function () {
+    const table = Buffer.alloc(3 * ref.sizeof.pointer);
+    const a = Buffer.alloc(1);
+    ref.writePointer(table, a, 0);
+    ref.writePointer(table, a, 2 * ref.sizeof.pointer);
+    const pointers = ref.readPointerArray(table, 0, 3, 1);
+    assert.strictEqual(ref.address(pointers[0]), ref.address(a));
+    assert.strictEqual(pointers[0].length, 1);
+    assert.strictEqual(pointers[1], null);
+    assert.strictEqual(ref.address(pointers[2]), ref.address(a));
+  });
+
+  it('should not read a table of pointers past the end of the Buffer', function () {
+    const table = Buffer.alloc(2 * ref.sizeof.pointer);
+    assert.throws(function () {
+      ref.readPointerArray(table, 0, 3, 0);
+    }, RangeError);
+    assert.throws(function () {
+      ref.readPointerArray(table, ref.sizeof.pointer, 2, 0);
+    }, RangeError);
+    assert.throws(function () {
+      ref.readPointerArray(table, 0, 2, -1);
+    }, RangeError);
+  });
+});
@@ -83,6 +83,28 @@ describe('Library', function () {
     }
   })
 
+  describe('open()', function () {
+    it('should resolve to an object with the functions defined', function () {
+      const lib = process.platform == 'win32' ? 'msvcrt' : 'libm';
+      return Library.open(lib, {
+        'ceil': [ 'double', [ 'double' ] ]
+      }).then(function (libm) {
+        assert(typeof libm.ceil === 'function');
+        assert(libm.ceil(1.1) === 2);
+      });
+    });
+
+    it('should reject when an invalid function name is used', function () {
+      return Library.open(null, {
+        'doesnotexist__': [ 'void', [] ]
+      }).then(function () {
+        assert(false); // unreachable
+      }, function (err) {
+        assert(/Dynamic Symbol Retrieval Error/.test(err.message));
+      });
+    });
+  });
+
   it('should work with "strcpy" and a 128 length string', function () {
     const lib = process.platform == 'win32' ? 'msvcrt.dll' : null;
     const ZEROS_128 = Array(128 + 1).join('0');
@@ -150,5 +172,33 @@ describe('Library', function () {
         done();
       });
     });
+
+    it('should queue calls beyond `maxConcurrency` in FIFO order', function (done) {
+      const lib = process.platform == 'win32' ? 'msvcrt' : 'libm';
+      const libm = new Library(lib, {
+          ceil: [ 'double', [ 'double' ], { async: { maxConcurrency: 1 } } ]
+      });
+      const results = [];
+      const inputs = [ 1.1, 2.1, 3.1 ];
+      inputs.forEach(function (input) {
+        libm.ceil(input, function (err, res) {
+          assert(err === null);
+          results.push(res);
+          if (results.length === inputs.length) {
+            assert.deepStrictEqual(results, [ 2, 3, 4 ]);
+            const stats = libm.ceil.stats();
+            assert.strictEqual(stats.inFlight, 0);
+            assert.strictEqual(stats.queued, 0);
+            assert.strictEqual(stats.completed, 3);
+            assert.strictEqual(stats.waitTime.count, 3);
+            done();
+          }
+        });
+      });
+      const stats = libm.ceil.stats();
+      assert.strictEqual(stats.maxConcurrency, 1);
+      assert.strictEqual(stats.inFlight, 1);
+      assert.strictEqual(stats.queued, 2);
+    });
   });
 });
@@ -0,0 +1,110 @@
+'use strict';
+const assert = require('assert');
+const ffi = require('../');
+const { types } = ffi
+const bindings = require('node-gyp-build')(__dirname);
+
+describe('nativeCallbacks', function () {
+  afterEach(global.gc);
+
+  const comparator = ffi.Function(types.int, [ types.voidPtr, types.voidPtr ]);
+  const libc = ffi.Library(process.platform == 'win32' ? 'msvcrt' : null, {
+    qsort: [ types.void, [ types.voidPtr, types.size_t, types.size_t, comparator ] ]
+  });
+
+  describe('compare()', function () {
+    it('should sort integers with qsort()', function () {
+      const values = Buffer.from(new Int32Array([ 3, -1, 2, 0 ]).buffer);
+      libc.qsort(values, 4n, 4n, ffi.nativeCallbacks.compare(types.int32));
+      assert.deepStrictEqual(Array.from(new Int32Array(values.buffer, values.byteOffset, 4)), [ -1, 0, 2, 3 ]);
+    });
+
+    it('should compare unsigned integers as unsigned', function () {
+      const values = Buffer.from(new Uint8Array([ 200, 1, 100 ]));
+      libc.qsort(values, 3n, 1n, ffi.nativeCallbacks.compare('uint8'));
+      assert.deepStrictEqual(Array.from(values), [ 1, 100, 200 ]);
+    });
+
+    it('should compare a field of struct elements in descending order', function () {
+      // { int id; double score; }
+      const stride = 16;
+      const values = Buffer.alloc(3 * stride);
+      [ 0.5, 2.5, 1.5 ].forEach(function (score, i) {
+        values.writeInt32LE(i, i * stride);
+        values.writeDoubleLE(score, i * stride + 8);
+      });
+      const cmp = ffi.nativeCallbacks.compare('double', { offset: 8, descending: true });
+      libc.qsort(values, 3n, BigInt(stride), cmp);
+      assert.deepStrictEqual([ 0, 1, 2 ].map(i => values.readInt32LE(i * stride)), [ 1, 2, 0 ]);
+    });
+  });
+
+  describe('memcmp()', function () {
+    it('should sort fixed size records bytewise', function () {
+      const values = Buffer.from('cabbaaabc');
+      libc.qsort(values, 3n, 3n, ffi.nativeCallbacks.memcmp(3));
+      assert.strictEqual(values.toString(), 'abcbaacab');
+    });
+  });
+
+  describe('collect()', function () {
+    it('should collect the arguments of calls from another thread', function () {
+      const sink = ffi.nativeCallbacks.collect([ 'int', 'double' ]);
+      const notify = ffi.ForeignFunction(bindings.notify_from_thread, 'void', [ 'pointer', 'int' ]);
+      notify(sink, 3);
+      assert.strictEqual(sink.count(), 3);
+      assert.deepStrictEqual(sink.values(), [ [ 0, 0 ], [ 1, 0.5 ], [ 2, 1 ] ]);
+      sink.reset();
+      assert.strictEqual(sink.buffer().length, 0);
+    });
+  });
+
+  describe('route()', function () {
+    it('should forward calls to its targets round-robin', function () {
+      const a = ffi.nativeCallbacks.counter('int', [ 'int' ]);
+      const b = ffi.nativeCallbacks.counter('int', [ 'int' ]);
+      const router = ffi.nativeCallbacks.route('int', [ 'int' ], [ a, b ]);
+      const fn = ffi.ForeignFunction(router, 'int', [ 'int' ]);
+      for (let i = 0; i < 4; i++) {
+        assert.strictEqual(fn(i), 0);
+      }
+      assert.strictEqual(router.count(), 4);
+      assert.strictEqual(a.count(), 2);
+      assert.strictEqual(b.count(), 2);
+    });
+
+    it('should read its targets from a shared table, until closed', function () {
+      const a = ffi.nativeCallbacks.counter('int', [ 'int' ]);
+      const table = new BigUint64Array(new SharedArrayBuffer(8 * 3));
+      table[0] = ffi.ref.address(a);
+      const router = ffi.nativeCallbacks.route('int', [ 'int' ], table);
+      const fn = ffi.ForeignFunction(router, 'int', [ 'int' ]);
+      fn(1);
+      assert.strictEqual(a.count(), 1);
+
+      Atomics.store(table, 1, 1n);
+      assert.strictEqual(fn(2), 0);
+      assert.strictEqual(a.count(), 1);
+      assert.strictEqual(table[2], 0n);
+    });
+  });
+
+  describe('counter()', function () {
+    it('should count its calls', function () {
+      const counter = ffi.nativeCallbacks.counter();
+      bindings.set_cb(counter);
+      bindings.call_cb();
+      bindings.call_cb();
+      assert.strictEqual(counter.count(), 2);
+      counter.reset();
+      assert.strictEqual(counter.count(), 0);
+    });
+
+    it('should be accepted by "ffi.Function" arguments', function () {
+      const counter = ffi.nativeCallbacks.counter('int', [ 'pointer', 'pointer' ]);
+      const callbackFunc = ffi.ForeignFunction(bindings.callback_func, comparator, [ comparator ]);
+      assert.strictEqual(callbackFunc(counter)(null, null), 0);
+      assert.strictEqual(counter.count(), 1);
+    });
+  });
+});
@@ -13,3 +13,42 @@ describe('alloc()', function() {
     assert.strictEqual(ref.types.bool, buf.type);
   });
 });
+
+describe('allocNative()', function() {
+  it('should return memory aligned to "align" bytes', function() {
+    const buf = ref.allocNative(100, { align: 64 });
+    assert.strictEqual(100, buf.length);
+    assert.strictEqual(0n, ref.address(buf) % 64n);
+    ref.free(buf);
+  });
+
+  it('should zero-fill the memory with "zero"', function() {
+    const buf = ref.allocNative(256, { zero: true });
+    assert(buf.every(b => b === 0));
+    ref.free(buf);
+  });
+
+  it('should zero-fill huge pages with "zero"', function() {
+    if (process.platform !== 'linux')
+      return this.skip('transparent huge pages are Linux only');
+    const buf = ref.allocNative(256, { zero: true, hugePages: true });
+    assert.strictEqual(256, buf.length);
+    assert(buf.every(b => b === 0));
+    ref.free(buf);
+  });
+
+  it('should detach the Buffer on free()', function() {
+    const buf = ref.allocNative(16);
+    ref.free(buf);
+    assert.strictEqual(0, buf.length);
+    assert.throws(() => ref.free(buf), /already freed/);
+  });
+
+  it('should only free() Buffers from allocNative()', function() {
+    assert.throws(() => ref.free(Buffer.alloc(8)), /not returned by allocNative/);
+  });
+
+  it('should throw for an alignment that is not a power of two', function() {
+    assert.throws(() => ref.allocNative(8, { align: 24 }), RangeError);
+  });
+});
@@ -0,0 +1,116 @@
+'use strict';
+const assert = require('assert');
+const ffi = require('../..');
+const { ref } = ffi;
+
+describe('Arena', function() {
+  it('should allocate typed values sharing one native chunk', function() {
+    const arena = new ref.Arena();
+    const a = arena.alloc('int', 42);
+    const b = arena.alloc(ref.types.double, 1.5);
+    assert.strictEqual(ref.types.int, a.type);
+    assert.strictEqual(ref.sizeof.int, a.length);
+    assert.strictEqual(42, ref.deref(a));
+    assert.strictEqual(1.5, ref.deref(b));
+    assert.strictEqual(a.buffer, b.buffer);
+    assert.strictEqual(0n, ref.address(b) % BigInt(ref.alignof.double));
+  });
+
+  it('should allocate C strings', function() {
+    const arena = ref.Arena();
+    const str = arena.allocCString('hello');
+    assert.strictEqual(6, str.length);
+    assert.strictEqual('hello', ref.readCString(str, 0));
+    assert(ref.isNull(arena.allocCString(null)));
+  });
+
+  it('should allocate struct instances', function() {
+    const Point = ffi.StructType({ x: 'int', y: 'int' });
+    const arena = new ref.Arena();
+    const p = arena.struct(Point, { x: 1, y: 2 });
+    assert(p instanceof Point);
+    assert.strictEqual(1, p.x);
+    assert.strictEqual(2, p.y);
+    assert.strictEqual(Point.size, p.ref().length);
+  });
+
+  it('should allocate a new chunk when one is full', function() {
+    const arena = new ref.Arena({ chunkSize: 16 });
+    const a = arena.alloc('uint64');
+    const b = arena.alloc('uint64');
+    const c = arena.alloc('uint64');
+    assert.strictEqual(a.buffer, b.buffer);
+    assert.notStrictEqual(a.buffer, c.buffer);
+    assert.strictEqual(64, arena.allocCString('x'.repeat(63)).length);
+    assert.strictEqual(16 + 16 + 64, arena.capacity);
+  });
+
+  it('should reuse the chunks after reset()', function() {
+    const arena = new ref.Arena({ chunkSize: 64 });
+    const a = arena.alloc('int', 7);
+    arena.reset();
+    const b = arena.alloc('int');
+    assert.strictEqual(ref.address(a), ref.address(b));
+    assert.strictEqual(0, ref.deref(b));
+    assert.strictEqual(64, arena.capacity);
+  });
+
+  it('should free the chunks allocated for large objects on reset()', function() {
+    const arena = new ref.Arena({ chunkSize: 16 });
+    arena.alloc('int');
+    const large = arena.allocCString('x'.repeat(63));
+    assert.strictEqual(16 + 64, arena.capacity);
+    arena.reset();
+    assert.strictEqual(16, arena.capacity);
+    assert.strictEqual(0, large.length);
+  });
+
+  it('should allocate addresses without a view', function() {
+    const arena = new ref.Arena({ chunkSize: 64 });
+    const a = arena.allocAddress(4, 4);
+    const b = arena.allocAddress(8, 8);
+    assert.strictEqual('number', typeof a);
+    assert.strictEqual(0, a % 4);
+    assert.strictEqual(0, b % 8);
+    assert(b >= a + 4);
+    ref.writeInt32At(a, -7, 0);
+    assert.strictEqual(-7, ref.readInt32At(a, 0));
+    const view = arena.alloc('int');
+    assert.strictEqual(Number(ref.address(view)), b + 8);
+  });
+
+  it('should align the addresses to more than the chunks are', function() {
+    const arena = new ref.Arena({ chunkSize: 256 });
+    arena.allocAddress(1, 1);
+    const a = arena.allocAddress(8, 64);
+    assert.strictEqual(0, a % 64);
+    arena.allocAddress(1, 1);
+    assert.strictEqual(0, arena.allocAddress(8, 64) % 64);
+    // larger than what is left of the chunk
+    assert.strictEqual(0, arena.allocAddress(200, 128) % 128);
+
+    const vector = {
+      name: 'vector', size: 32, alignment: 32, indirection: 1,
+      get: (buf, offset) => buf.readInt32LE(offset),
+      set: (buf, value, offset) => buf.writeInt32LE(value, offset)
+    };
+    const Wide = ffi.StructType({ x: vector });
+    assert.strictEqual(32, Wide.alignment);
+    const wide = arena.struct(Wide, { x: 1 });
+    assert.strictEqual(0n, ref.address(wide.ref()) % 32n);
+    assert.strictEqual(1, wide.x);
+    arena.destroy();
+  });
+
+  it('should free all of the chunks on destroy()', function() {
+    const arena = new ref.Arena({ chunkSize: 64 });
+    const a = arena.alloc('int', 7);
+    arena.destroy();
+    assert.strictEqual(0, arena.capacity);
+    // detached, rather than a view of freed memory
+    assert.strictEqual(0, a.length);
+    assert.strictEqual(3, ref.deref(arena.alloc('int', 3)));
+    assert.strictEqual(64, arena.capacity);
+    arena.destroy();
+  });
+});
@@ -0,0 +1,50 @@
+'use strict';
+const assert = require('assert');
+const ffi = require('../..');
+const { ref } = ffi;
+
+describe('handle', function() {
+  const libc = ffi.Library(null, {
+    malloc: [ 'handle', [ 'size_t' ] ],
+    free: [ 'void', [ 'handle' ] ],
+    strcpy: [ 'handle', [ 'handle', 'string' ] ]
+  });
+
+  it('should return pointers as plain Numbers', function() {
+    const handle = libc.malloc(16n);
+    assert.strictEqual('number', typeof handle);
+    assert(!ref.isNull(handle));
+    libc.free(handle);
+  });
+
+  it('should read and write the memory at an address', function() {
+    const handle = libc.malloc(32n);
+    ref.writeInt32At(handle, -5, 0);
+    ref.writeUInt32At(handle, 0xdeadbeef, 4);
+    ref.writeDoubleAt(handle, 1.25, 8);
+    ref.writeUInt64At(handle, 1n << 63n, 16);
+    ref.writePointerAt(handle, handle, 24);
+    assert.strictEqual(-5, ref.readInt32At(handle, 0));
+    assert.strictEqual(0xdeadbeef, ref.readUInt32At(handle, 4));
+    assert.strictEqual(1.25, ref.readDoubleAt(handle, 8));
+    assert.strictEqual(1n << 63n, ref.readUInt64At(handle, 16));
+    assert.strictEqual(handle, ref.readPointerAt(handle, 24));
+
+    assert.strictEqual(handle, libc.strcpy(handle, 'hello'));
+    assert.strictEqual('hello', ref.readCStringAt(handle, 0));
+    libc.free(handle);
+  });
+
+  it('should read and write addresses in Buffers', function() {
+    const buf = ref.alloc(ref.types.handle, 0x1234);
+    assert.strictEqual(0x1234, ref.deref(buf));
+    assert.strictEqual(0x1234, ref.readAddress(buf, 0));
+    ref.writeAddress(buf, null, 0);
+    assert.strictEqual(0, ref.deref(buf));
+    assert(ref.isNull(ref.deref(buf)));
+  });
+
+  it('should throw when accessing the NULL address', function() {
+    assert.throws(() => ref.readInt32At(0, 0), /NULL address/);
+  });
+});
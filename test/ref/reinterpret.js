@@ -30,6 +30,38 @@ describe('reinterpret()', function() {
     assert.strictEqual(small.toString(), reinterpreted.toString());
   })
 
+  it('should wrap a native address in a single ArrayBuffer', function() {
+    const memory = Buffer.alloc(32);
+    memory.write('hello world', 8);
+    const pointer = Buffer.alloc(ref.sizeof.pointer);
+    ref.writePointer(pointer, memory.subarray(8), 0);
+
+    const empty = ref.readPointer(pointer, 0);
+    assert.strictEqual(0, empty.length);
+    assert.strictEqual(ref.address(memory) + 8n, ref.address(empty));
+
+    // longer and shorter views of the same address, in any order, all share
+    // its ArrayBuffer
+    const short = ref.readPointer(pointer, 0, 5);
+    assert.strictEqual('hello', short.toString());
+    const long = ref.reinterpret(short, 11);
+    assert.strictEqual(11, long.length);
+    assert.strictEqual('hello world', long.toString());
+    assert.strictEqual(empty.buffer, short.buffer);
+    assert.strictEqual(short.buffer, long.buffer);
+    assert.strictEqual(short.buffer, ref.readPointer(pointer, 0, 16).buffer);
+
+    long[0] = 'j'.charCodeAt(0);
+    assert.strictEqual('jello', short.toString());
+  });
+
+  it('should reject negative lengths', function() {
+    const buf = Buffer.alloc(8);
+    assert.throws(() => ref.reinterpret(buf, -1), RangeError);
+    const pointer = ref.alloc('pointer', buf);
+    assert.throws(() => ref.readPointer(pointer, 0, -1), RangeError);
+  });
+
   it('should retain a reference to the original Buffer when reinterpreted', function() {
     if (weak === undefined)
       return this.skip('weak not avaialbe');
@@ -31,6 +31,33 @@ describe('reinterpretUntilZeros()', function() {
     assert.strictEqual(buf2.toString('ucs2'), str);
   })
 
+  it('should find aligned 4 and 8-byte terminators past the first blocks', function() {
+    for (const size of [ 4, 8 ]) {
+      const buf = Buffer.alloc(size * 100, 0xff);
+      buf.fill(0, size * 77, size * 78);
+      // zero bytes straddling two elements don't terminate
+      buf.fill(0, size * 10 + size / 2, size * 11 + size / 2);
+      assert.strictEqual(size * 77, ref.reinterpretUntilZeros(buf, size).length);
+      assert.strictEqual(size * 76, ref.reinterpretUntilZeros(buf, size, size).length);
+    }
+  });
+
+  it('should scan unaligned 2-byte sequences element by element', function() {
+    const buf = Buffer.alloc(64, 0x41);
+    buf.fill(0, 2, 3);
+    buf.fill(0, 41, 43);
+    assert.strictEqual(40, ref.reinterpretUntilZeros(buf, 2, 1).length);
+  });
+
+  it('should stop at the maximum length without a terminator before', function() {
+    const buf = Buffer.alloc(256, 0x41);
+    buf.fill(0, 200);
+    assert.strictEqual(100, ref.reinterpretUntilZeros(buf, 1, 0, 100).length);
+    assert.strictEqual(100, ref.reinterpretUntilZeros(buf, 2, 0, 100).length);
+    assert.strictEqual(96, ref.reinterpretUntilZeros(buf, 8, 0, 100).length);
+    assert.strictEqual(200, ref.reinterpretUntilZeros(buf, 2, 0, 1000).length);
+  });
+
   it('should return a large Buffer instance > 10,000 bytes with UTF16-LE char bytes', function() {
     const data = fs.readFileSync(__dirname + '/utf16le.bin');
     const strBuf = ref.reinterpretUntilZeros(data, 2);
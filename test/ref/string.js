@@ -1,6 +1,9 @@
 'use strict';
 const assert = require('assert');
-const { ref } = require('../..');
+const path = require('path');
+const ffi = require('../..');
+const { ref } = ffi;
+const bindings = require('node-gyp-build')(path.join(__dirname, '..'));
 
 describe('C string', function() {
   describe('readCString()', function() {
@@ -19,6 +22,62 @@ describe('C string', function() {
         ref.readCString(NULL);
       });
     });
+
+    it('should decode "latin1" and other encodings', function() {
+      const buf = Buffer.from([ 0x63, 0x61, 0x66, 0xe9, 0, 0x41 ]);
+      assert.strictEqual('caf\u00e9', ref.readCString(buf, 0, 'latin1'));
+      assert.strictEqual('636166e9', ref.readCString(buf, 0, 'hex'));
+      assert.strictEqual('caf\ufffd', ref.readCString(buf, 0));
+    });
+  });
+
+  describe('readCStringAndFree()', function() {
+    const libc = ffi.Library(null, {
+      strdup: [ 'handle', [ 'string' ] ]
+    });
+    const owned = ffi.ForeignFunction(ffi.DynamicLibrary().get('strdup'),
+      'OwnedCString', [ 'string' ]);
+
+    it('should read and free a malloc()\'d string', function() {
+      assert.strictEqual('hello world', ref.readCStringAndFree(libc.strdup('hello world')));
+      assert.strictEqual(null, ref.readCStringAndFree(0));
+    });
+
+    it('should decode the strings returned as OwnedCString', function() {
+      assert.strictEqual('h\u00e9llo', owned('h\u00e9llo'));
+    });
+
+    it('should free the strings returned as OwnedCString', function() {
+      if (bindings.malloc_mmapped_bytes === undefined)
+        return this.skip('counting the frees needs glibc >= 2.33');
+      const largeString = ffi.ForeignFunction(bindings.large_string, 'OwnedCString', [ 'int' ]);
+      const mmappedBytes = ffi.ForeignFunction(bindings.malloc_mmapped_bytes, 'size_t', [ ]);
+      const length = 40 * 1024 * 1024;
+      const before = Number(mmappedBytes());
+      assert.strictEqual(length, largeString(length).length);
+      assert(Number(mmappedBytes()) - before < length, 'the string was not freed');
+    });
+
+    it('should free an OwnedCString struct field only once', function() {
+      const Message = ffi.StructType({ id: 'int', text: 'OwnedCString' });
+      const message = new Message({ id: 1, text: 'hello' });
+      assert.strictEqual('hello', message.text);
+      assert.strictEqual(null, message.text);
+      assert.strictEqual(null, message.text);
+    });
+
+    it('should detach a Buffer of the string it frees', function() {
+      const pointer = ref.alloc('handle', libc.strdup('hello world'));
+      const buf = ref.readPointer(pointer, 0, 12);
+      assert.strictEqual('hello world', ref.readCStringAndFree(buf));
+      assert.strictEqual(0, buf.length);
+    });
+
+    it('should not free() the memory of Buffers that malloc() did not allocate', function() {
+      const buf = ref.allocNative(8, { zero: true });
+      assert.throws(() => ref.readCStringAndFree(buf), /malloc\(\) did not allocate/);
+      ref.free(buf);
+    });
   });
 
   describe('writeCString()', function() {
@@ -99,4 +158,116 @@ describe('C string', function() {
       assert.strictEqual(str, ref.get(buf, 0));
     });
   });
+
+  describe('internedCString()', function() {
+    it('should read the same String again while the C string is unchanged', function() {
+      const type = ref.internedCString();
+      const store = Buffer.from('hello\0');
+      const buf = ref.alloc(type);
+      ref.writePointer(buf, store);
+      assert.strictEqual('hello', ref.get(buf, 0, type));
+      assert.strictEqual('hello', ref.get(buf, 0, type));
+
+      store.write('jello');
+      assert.strictEqual('jello', ref.get(buf, 0, type));
+      store.write('hi\0');
+      assert.strictEqual('hi', ref.get(buf, 0, type));
+
+      ref.writePointer(buf, ref.NULL);
+      assert.strictEqual(null, ref.get(buf, 0, type));
+    });
+
+    it('should pass the same native copy of a String', function() {
+      const type = ref.internedCString({ writeCacheSize: 1 });
+      const a = ref.alloc(type, 'SELECT 1');
+      const b = ref.alloc(type, 'SELECT 1');
+      const address = ref.address(ref.readPointer(a, 0, 0));
+      assert.strictEqual(address, ref.address(ref.readPointer(b, 0, 0)));
+      assert.strictEqual('SELECT 1', ref.deref(b));
+
+      // evicted, but still alive for `a` and `b`
+      ref.alloc(type, 'SELECT 2');
+      const c = ref.alloc(type, 'SELECT 1');
+      assert.notStrictEqual(address, ref.address(ref.readPointer(c, 0, 0)));
+      assert.strictEqual('SELECT 1', ref.deref(a));
+    });
+
+    it('should pass a fresh copy for the mutable variant, or a Buffer', function() {
+      const type = ref.internedCString();
+      const a = ref.alloc(type, 'buf');
+      const address = ref.address(ref.readPointer(a, 0, 0));
+      const b = ref.alloc(type.mutable, 'buf');
+      assert.notStrictEqual(address, ref.address(ref.readPointer(b, 0, 0)));
+      assert.strictEqual('buf', ref.deref(b));
+      const copy = ref.allocCString('buf');
+      const c = ref.alloc(type, copy);
+      assert.strictEqual(ref.address(copy), ref.address(ref.readPointer(c, 0, 0)));
+    });
+
+    it('should work as the return type of a function', function() {
+      process.env.REF_INTERNED_CSTRING = 'interned';
+      const getenv = ffi.ForeignFunction(ffi.DynamicLibrary().get('getenv'),
+        'InternedCString', [ 'InternedCString' ]);
+      assert.strictEqual('interned', getenv('REF_INTERNED_CSTRING'));
+      assert.strictEqual('interned', getenv('REF_INTERNED_CSTRING'));
+      assert.strictEqual(null, getenv('REF_INTERNED_CSTRING_UNSET'));
+    });
+  });
+
+  describe('wide strings', function() {
+    const str = 'h\u00e9llo \ud83d\ude00';
+
+    [ 'U16String', 'U32String', 'WString' ].forEach(function (name) {
+      it('should write and read back a ' + name, function() {
+        const buf = ref.alloc(name, str);
+        assert.strictEqual(str, ref.deref(buf));
+
+        const long = str.repeat(1000);
+        assert.strictEqual(long, ref.deref(ref.alloc(name, long)));
+
+        ref.set(buf, null, 0);
+        assert.strictEqual(null, ref.deref(buf));
+      });
+    });
+
+    it('should read UTF-16 and UTF-32 code units from a Buffer', function() {
+      const buf = ref.alloc('pointer');
+      ref.writePointer(buf, Buffer.from('hi\u00e9\0', 'utf16le'));
+      assert.strictEqual('hi\u00e9', ref.get(buf, 0, ref.types.U16String));
+
+      const units = new Uint32Array([ 0x68, 0x1f600, 0xd800, 0x110000, 0 ]);
+      ref.writePointer(buf, Buffer.from(units.buffer));
+      assert.strictEqual('h\ud83d\ude00\ufffd\ufffd', ref.get(buf, 0, ref.types.U32String));
+    });
+
+    it('should read long strings as external strings where Node.js has them', function() {
+      const [ major, minor ] = process.versions.node.split('.').map(Number);
+      const supported = major > 20 || (major === 20 && minor >= 4) || (major === 18 && minor >= 18);
+      if (!supported)
+        return this.skip('node_api_create_external_string_utf16() needs v18.18.0 or v20.4.0');
+      assert.strictEqual(true, ref._hasExternalStrings);
+
+      // long enough for the external string path, which holds a copy of them
+      const long = 'x\u00e9\ud83d\ude00'.repeat(2048);
+      [ 'U16String', 'U32String' ].forEach(function (name) {
+        const buf = ref.alloc(name, long);
+        const pointee = ref.readPointer(buf, 0, 4);
+        const read = ref.deref(buf);
+        pointee.fill(0);
+        assert.strictEqual(long, read);
+      });
+    });
+
+    it('should encode lone surrogates as U+FFFD in UTF-32', function() {
+      const buf = ref.alloc('U32String', 'a\ud800b');
+      assert.strictEqual('a\ufffdb', ref.deref(buf));
+    });
+
+    it('should pass wchar_t strings to C functions', function() {
+      const wcschr = ffi.ForeignFunction(ffi.DynamicLibrary().get('wcschr'),
+        'WString', [ 'WString', 'int' ]);
+      assert.strictEqual('llo \ud83d\ude00', wcschr(str, 'l'.charCodeAt(0)));
+      assert.strictEqual(null, wcschr(str, 'z'.charCodeAt(0)));
+    });
+  });
 });
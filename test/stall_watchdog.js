@@ -0,0 +1,72 @@
+'use strict';
+const assert = require('assert');
+const ffi = require('../');
+const bindings = require('node-gyp-build')(__dirname);
+const watchdog = ffi.stallWatchdog;
+
+describe('stallWatchdog', function () {
+  afterEach(global.gc);
+  afterEach(function () {
+    watchdog.disable();
+    watchdog.removeAllListeners('stall');
+  });
+
+  it('should be disabled by default', function () {
+    assert.strictEqual(false, watchdog.enabled);
+  });
+
+  it('should throw for a non-positive threshold', function () {
+    assert.throws(function () {
+      watchdog.enable({ threshold: 0 });
+    }, /positive "threshold"/);
+  });
+
+  it('should not report calls below the threshold', function () {
+    const abs = ffi.ForeignFunction(bindings.abs, 'int', [ 'int' ]);
+    const count = watchdog.count;
+    watchdog.enable({ threshold: 10000 });
+    watchdog.on('stall', function () {
+      assert(false); // unreachable
+    });
+    assert.strictEqual(5, abs(-5));
+    assert.strictEqual(count, watchdog.count);
+  });
+
+  if (process.platform !== 'win32') {
+    it('should report the name, duration and caller of a stalled call', function () {
+      const libc = new ffi.Library('libc', {
+        'usleep': [ 'int', [ 'uint' ] ]
+      });
+      const stalls = [];
+      const count = watchdog.count;
+      watchdog.enable({ threshold: 5 });
+      watchdog.on('stall', function (info) { stalls.push(info); });
+
+      (function someSlowCaller () {
+        libc.usleep(20000);
+      })();
+
+      assert.strictEqual(count + 1, watchdog.count);
+      assert.strictEqual(1, stalls.length);
+      assert.strictEqual('usleep', stalls[0].name);
+      assert(stalls[0].duration >= 5);
+      assert(/someSlowCaller/.test(stalls[0].stack));
+
+      watchdog.disable();
+      libc.usleep(20000);
+      assert.strictEqual(1, stalls.length);
+    });
+
+    it('should keep the errno of a stalled call for ffi.errno()', function () {
+      const failSlowly = ffi.ForeignFunction(bindings.fail_slowly, 'int', [ 'int', 'int' ]);
+      const fs = require('fs');
+      watchdog.enable({ threshold: 5 });
+      watchdog.on('stall', function () {
+        // fails with ENOENT
+        fs.existsSync('/nonexistent/ffi-stall-watchdog');
+      });
+      assert.strictEqual(-1, failSlowly(20, 42));
+      assert.strictEqual(42, ffi.errno());
+    });
+  }
+});
@@ -20,23 +20,45 @@ export interface Library {
 
     /**
      * @param libFile name of library
-     * @param funcs hash of [retType, [...argType], opts?: {abi?, async?, varargs?}]
+     * @param funcs hash of [retType, [...argType], opts?: {abi?, async?: boolean | {maxConcurrency?}, adaptive?: {threshold?, minSamples?}, varargs?}]
      * @param lib hash that will be extended
      */
     new (libFile: string | null, funcs?: {[key: string]: any[]}, lib?: object): any;
 
     /**
      * @param libFile name of library
-     * @param funcs hash of [retType, [...argType], opts?: {abi?, async?, varargs?}]
+     * @param funcs hash of [retType, [...argType], opts?: {abi?, async?: boolean | {maxConcurrency?}, adaptive?: {threshold?, minSamples?}, varargs?}]
      * @param lib hash that will be extended
      */
     (libFile: string | null, funcs?: {[key: string]: any[]}, lib?: object): any;
+
+    /** Like the constructor, but does the `dlopen` and `dlsym`s on the thread pool. */
+    open(libFile: string | null, funcs?: {[key: string]: any[]}, lib?: object): Promise<any>;
 }
 export const Library: Library;
 
 /** Get value of errno. */
 export function errno(): number;
 
+/** A synchronous foreign function call that exceeded the watchdog threshold. */
+export interface StallInfo {
+    name: string | null;
+    /** Time spent inside the native function, in milliseconds. */
+    duration: number;
+    stack: string;
+}
+
+/** Opt-in detector for synchronous foreign function calls blocking the event loop. */
+export interface StallWatchdog extends NodeJS.EventEmitter {
+    readonly enabled: boolean;
+    threshold: number;
+    count: number;
+    enable(opts?: { threshold?: number }): this;
+    disable(): this;
+}
+
+export const stallWatchdog: StallWatchdog;
+
 export interface Function extends Type<any> {
     /** The type of return value. */
     retType: Type<any>;
@@ -58,9 +80,48 @@ export const Function: {
     (retType: Type<any>, argTypes: any[], abi?: number): Function;
 };
 
+/** Percentiles of a latency histogram, in milliseconds. */
+export interface LatencyStats {
+    count: number;
+    p50: number;
+    p90: number;
+    p99: number;
+    max: number;
+}
+
+/** Live counters of a foreign function created with `{async: {maxConcurrency}}`. */
+export interface AsyncCallStats {
+    maxConcurrency: number;
+    inFlight: number;
+    queued: number;
+    completed: number;
+    waitTime: LatencyStats;
+}
+
+/** Adaptive offload decision of a foreign function created with `{adaptive}`. */
+export interface CallStats {
+    threshold: number;
+    minSamples: number;
+    offloaded: boolean;
+    execTime: LatencyStats;
+}
+
+export interface ForeignFunctionOptions {
+    async?: boolean | { maxConcurrency?: number };
+    /** Route `promise()` calls to the thread pool once the p99 exceeds `threshold` ms. */
+    adaptive?: { threshold?: number, minSamples?: number };
+}
+
 export interface ForeignFunction {
     (...args: any[]): any;
-    async(...args: any[]): void;
+    async: {
+        (...args: any[]): void;
+        /** Only present when created with `{async: {maxConcurrency}}`. */
+        stats?(): AsyncCallStats;
+    };
+    promise(...args: any[]): Promise<any>;
+    /** Only present when created with `{adaptive}`. */
+    stats?(): CallStats;
 }
 
 /**
@@ -70,8 +131,8 @@ export interface ForeignFunction {
  * execution.
  */
 export const ForeignFunction: {
-    new (funcPtr: Buffer, retType: Type<any>, argTypes: any[], abi?: number): ForeignFunction;
-    (funcPtr: Buffer, retType: Type<any>, argTypes: any[], abi?: number): ForeignFunction;
+    new (funcPtr: Buffer, retType: Type<any>, argTypes: any[], abi?: number, options?: ForeignFunctionOptions): ForeignFunction;
+    (funcPtr: Buffer, retType: Type<any>, argTypes: any[], abi?: number, options?: ForeignFunctionOptions): ForeignFunction;
 };
 
 export interface VariadicForeignFunction {
@@ -131,6 +192,8 @@ export const DynamicLibrary: {
 
     new (path?: string, mode?: number): DynamicLibrary;
     (path?: string, mode?: number): DynamicLibrary;
+    /** Does the `dlopen` and the `dlsym` of all the `symbols` on the thread pool. */
+    open(path?: string | null, mode?: number, symbols?: string[]): Promise<DynamicLibrary>;
 };
 
 /**
@@ -138,14 +201,87 @@ export const DynamicLibrary: {
  * The function pointer may be used in other C functions that
  * accept C callback functions.
  */
+export interface CallbackOptions {
+    /** Calls from other threads queue a copy of the arguments and return right away. */
+    nonBlocking?: boolean;
+    /** Max queued calls, defaults to 1024. */
+    queueSize?: number;
+    /** What to do with calls once the queue is full, defaults to `'block'`. */
+    onFull?: 'block' | 'drop' | 'error';
+    /** Implies `nonBlocking`; `fn` gets called once per drain, with an Array of argument Arrays. */
+    batch?: boolean;
+    /** Runs `fn`, the path of a module exporting the function, in this many `worker_threads`; types given by name. */
+    workers?: number;
+    /** With `workers`: the argument whose value picks the worker, instead of round-robin. */
+    key?: number;
+    /** With `workers`: milliseconds to wait for the workers to start, defaults to 30000. */
+    startupTimeout?: number;
+}
+
+/** The C function pointer of a `Callback`. */
+export interface CallbackPointer extends Buffer {
+    /** Releases the closure for reuse right away; the pointer must not be called anymore. */
+    free(): void;
+    /** With `workers`: makes calls return 0, then terminates the workers once the calls in flight returned. */
+    close?(): Promise<void>;
+    /** With `workers`: resolves once all of the workers have started. */
+    ready?: Promise<void>;
+}
+
 export interface Callback {
-    new (retType: any, argTypes: any[], abi: number, fn: any): Buffer;
-    new (retType: any, argTypes: any[], fn: any): Buffer;
-    (retType: any, argTypes: any[], abi: number, fn: any): Buffer;
-    (retType: any, argTypes: any[], fn: any): Buffer;
+    new (retType: any, argTypes: any[], abi: number, fn: any, options?: CallbackOptions): CallbackPointer;
+    new (retType: any, argTypes: any[], fn: any, options?: CallbackOptions): CallbackPointer;
+    (retType: any, argTypes: any[], abi: number, fn: any, options?: CallbackOptions): CallbackPointer;
+    (retType: any, argTypes: any[], fn: any, options?: CallbackOptions): CallbackPointer;
+    /** Iterations a native thread busy-waits for a callback before sleeping. */
+    setSpinCount(count: number): void;
 }
 export const Callback: Callback;
 
+export interface InterfaceOptions {
+    /** Whether the instance starts with a pointer to the function table, defaults to `true`. */
+    indirect?: boolean;
+    /** Whether the functions take the instance as their first argument, defaults to `true`. */
+    receiver?: boolean;
+    abi?: number;
+}
+
+/** Binds C interfaces: structs of function pointers, like COM vtables. */
+export function Interface(layout: {[name: string]: [any, any[], number?]}, options?: InterfaceOptions):
+    (instance: Buffer) => {[name: string]: ((...args: any[]) => any) | null};
+
+export interface ComparatorOptions {
+    /** Offset of the compared field into the elements, defaults to 0. */
+    offset?: number;
+    descending?: boolean;
+}
+
+/** A natively implemented function pointer counting its calls. */
+export interface NativeCounter extends Buffer {
+    count(): number;
+    reset(): void;
+}
+
+/** A natively implemented function pointer collecting its arguments. */
+export interface NativeSink extends NativeCounter {
+    /** The arguments of each call so far. */
+    values(): any[][];
+    /** A copy of the collected arguments, laid out like the fields of a C struct. */
+    buffer(): Buffer;
+}
+
+/** Ready-made C function pointers that never enter JS. */
+export const nativeCallbacks: {
+    /** An `int (*)(const void*, const void*)` comparator of numbers of `type`. */
+    compare(type: any, options?: ComparatorOptions): Buffer;
+    /** An `int (*)(const void*, const void*)` comparator of `size` bytes. */
+    memcmp(size: number, options?: ComparatorOptions): Buffer;
+    collect(argTypes: any[], abi?: number): NativeSink;
+    counter(retType?: any, argTypes?: any[], abi?: number): NativeCounter;
+    /** Forwards each call to one of `targets`, round-robin or picked by argument number `options.key`. */
+    route(retType: any, argTypes: any[], targets: Array<Buffer | bigint> | BigUint64Array, options?: { key?: number, abi?: number }): NativeCounter;
+};
+
 export const ffiType: {
     /** Get a `ffi_type *` Buffer appropriate for the given type. */
     (type: Type<any>): Buffer
@@ -211,6 +347,18 @@ export const types: {
 
     Object: Type<object>;
     CString: Type<string>;
+    /** A `char *` string whose memory is free()d once read. */
+    OwnedCString: Type<string | null>;
+    /** A `CString` interning the strings read and written, see `ref.internedCString()`. */
+    InternedCString: Type<string | null> & { mutable: Type<string | null> };
+    /** `wchar_t *` strings, UTF-16 on Windows and UTF-32 elsewhere. */
+    WString: Type<string | null>;
+    /** `char16_t *` UTF-16 strings. */
+    U16String: Type<string | null>;
+    /** `char32_t *` UTF-32 strings. */
+    U32String: Type<string | null>;
+    /** Opaque pointers, read as their address instead of as a Buffer. */
+    handle: Type<number | bigint>;
 
     charPtr: Type<Type<string>>;
     voidPtr: Type<Type<undefined>>;
@@ -27,7 +27,7 @@ export interface ArrayType<T> extends Type<T> {
      * for the ArrayType. The "length" of the Array is determined by searching
      * through the buffer's contents until an aligned NULL pointer is encountered.
      */
-    untilZeros(buffer: Buffer): ArrayTypeValue<T>;
+    untilZeros(buffer: Buffer, maxLength?: number): ArrayTypeValue<T>;
 
     new (length?: number): ArrayTypeValue<T>;
     new (data: ArrayTypeValue<T>['element'][], length?: number): ArrayTypeValue<T>;
@@ -18,6 +18,36 @@ export declare function alloc<T>(type: Type<T>, value?: TypedBuffer<T>['self']):
  */
 export declare function allocCString(string: string, encoding?: string): Buffer;
 
+/**
+ * Allocate native memory, aligned to `align` bytes, which is freed by `free()`
+ * or when the buffer is garbage collected. The size is reported to V8 as
+ * external memory.
+ */
+export declare function allocNative(size: number, options?: { align?: number, hugePages?: boolean, zero?: boolean }): Buffer;
+/** Free the memory of a buffer returned by `allocNative()` right away. */
+export declare function free(buffer: Buffer): void;
+/**
+ * A bump allocator carving `alloc()`, `allocCString()` and struct instances
+ * out of large native chunks. `reset()` frees all of them at once and reuses
+ * the chunks, so the Buffers allocated before it must not be used anymore.
+ * `destroy()` frees the chunks themselves.
+ */
+export declare class Arena {
+    constructor(options?: { chunkSize?: number });
+    /** The size of the native chunks, in bytes. */
+    chunkSize: number;
+    /** The total size of the chunks allocated so far, in bytes. */
+    readonly capacity: number;
+    alloc<T>(type: Type<T> | string, value?: any): TypedBuffer<T>['refer'];
+    allocCString(string: string, encoding?: string): Buffer;
+    struct<T>(StructType: { new (buffer: Buffer, data?: any): T }, data?: any): T;
+    /** The address of `size` bytes of uninitialized memory, with no Buffer for them. */
+    allocAddress(size: number, alignment?: number): number | bigint;
+    /** Frees all of the objects allocated so far, keeping the chunks of `chunkSize` bytes. */
+    reset(): void;
+    /** Frees all of the chunks right away, detaching the Buffers allocated from them. */
+    destroy(): void;
+}
 /**
  * Get value after dereferencing buffer.
  * That is, first it checks the indirection count of buffer's type, and
@@ -36,14 +66,60 @@ export declare function get<T>(buffer: TypedBuffer<T>, offset?: number, type?: T
 /** Get type of the buffer. Create a default type when none exists. */
 export declare function getType<T>(buffer: TypedBuffer<T>): Type<T>;
 /** Check the NULL. */
-export declare function isNull(buffer: Buffer): boolean;
+export declare function isNull(buffer: Buffer | number | bigint | null): boolean;
 /** Read C string until the first NULL. */
-export declare function readCString(buffer: Buffer, offset?: number): string;
+export declare function readCString(buffer: Buffer, offset?: number, encoding?: string): string;
+/** Read the C string at the pointer, then free() it. `null` for NULL. */
+export declare function readCStringAndFree(pointer: Buffer | number | bigint, encoding?: 'utf8' | 'latin1'): string | null;
+/**
+ * Create a `CString` type with a bounded cache in each direction: reading
+ * returns the String already decoded from an unchanged C string at the same
+ * address, writing passes the native copy already encoded for the String,
+ * shared by every call: for `const char *` parameters only. Its `mutable`
+ * variant passes a fresh copy per call instead.
+ */
+export declare function internedCString(options?: { readCacheSize?: number, writeCacheSize?: number }): Type<string | null> & { mutable: Type<string | null> };
 
 /** Read a JS Object that has previously been written. */
 export declare function readObject(buffer: Buffer, offset?: number): Object;
 /** Read data from the pointer. */
 export declare function readPointer(buffer: Buffer, offset?: number, length?: number): Buffer;
+/** Read `count` consecutive pointers, `null` for the NULL ones. */
+export declare function readPointerArray(buffer: Buffer, offset: number, count: number, length?: number): Array<Buffer | null>;
+
+/** An address, as read by the `handle` type. A BigInt only past 2^53. */
+export type Address = number | bigint;
+/** Read the pointer as its address instead of as a Buffer. */
+export declare function readAddress(buffer: Buffer, offset?: number): Address;
+/** Write the address, `null` for NULL. */
+export declare function writeAddress(buffer: Buffer, address: Address | Buffer | null, offset?: number): void;
+
+/** Accessors for the memory at an address, without creating a Buffer. */
+export declare function readInt8At(address: Address, offset?: number): number;
+export declare function readUInt8At(address: Address, offset?: number): number;
+export declare function readInt16At(address: Address, offset?: number): number;
+export declare function readUInt16At(address: Address, offset?: number): number;
+export declare function readInt32At(address: Address, offset?: number): number;
+export declare function readUInt32At(address: Address, offset?: number): number;
+export declare function readInt64At(address: Address, offset?: number): bigint;
+export declare function readUInt64At(address: Address, offset?: number): bigint;
+export declare function readFloatAt(address: Address, offset?: number): number;
+export declare function readDoubleAt(address: Address, offset?: number): number;
+export declare function readPointerAt(address: Address, offset?: number): Address;
+/** `readPointerArray()` at an address, with no Buffer to bound it. */
+export declare function readPointerArrayAt(address: Address | Buffer, offset: number, count: number, length?: number): Array<Buffer | null>;
+export declare function readCStringAt(address: Address, offset?: number): string;
+export declare function writeInt8At(address: Address, value: number, offset?: number): void;
+export declare function writeUInt8At(address: Address, value: number, offset?: number): void;
+export declare function writeInt16At(address: Address, value: number, offset?: number): void;
+export declare function writeUInt16At(address: Address, value: number, offset?: number): void;
+export declare function writeInt32At(address: Address, value: number, offset?: number): void;
+export declare function writeUInt32At(address: Address, value: number, offset?: number): void;
+export declare function writeInt64At(address: Address, value: bigint | number, offset?: number): void;
+export declare function writeUInt64At(address: Address, value: bigint | number, offset?: number): void;
+export declare function writeFloatAt(address: Address, value: number, offset?: number): void;
+export declare function writeDoubleAt(address: Address, value: number, offset?: number): void;
+export declare function writePointerAt(address: Address, value: Address | Buffer | null, offset?: number): void;
 
 /** Create pointer to buffer. */
 export declare function ref<T>(buffer: ArrayTypeValue<T>):ArrayTypeValue<T>['refer']
@@ -63,7 +139,7 @@ export declare function reinterpret(buffer: Buffer, size: number,
  * of aligned NULL bytes.
  */
 export declare function reinterpretUntilZeros(buffer: Buffer, size: number,
-    offset?: number): Buffer;
+    offset?: number, maxLength?: number): Buffer;
 
 /** Write pointer if the indirection is 1, otherwise write value. */
 export declare function set<T>(buffer: TypedBuffer<T>, value: TypedBuffer<T>["value"], offset: number, type?: Type<T>): void;
@@ -92,7 +168,7 @@ export declare function _attach(buffer: Buffer, object: Object): void;
 /** Same as ref.reinterpret, except that this version does not attach buffer. */
 export declare function _reinterpret(buffer: Buffer, size: number, offset?: number): Buffer;
 /** Same as ref.reinterpretUntilZeros, except that this version does not attach buffer. */
-export declare function _reinterpretUntilZeros(buffer: Buffer, size: number, offset?: number): Buffer;
+export declare function _reinterpretUntilZeros(buffer: Buffer, size: number, offset?: number, maxLength?: number): Buffer;
 /** Same as ref.writePointer, except that this version does not attach pointer. */
 export declare function _writePointer(buffer: Buffer, pointer: Buffer, offset: number): void;
 /** Same as ref.writeObject, except that this version does not attach object. */